@@ -3,12 +3,20 @@
 #define JLIB_VERSION 1.5.1
 #include <printf.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
 #include <assert.h>
 #include <stddef.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 typedef uint32_t u32;
 typedef int32_t i32;
@@ -30,6 +38,61 @@ typedef double f64;
 #define J_GB(x) ((x) * 1024 * 1024 * 1024)
 #define J_TB(x) ((x) * 1024 * 1024 * 1024 * 1024)
 
+// MARK: - SIMD
+
+/**
+ * Byte vectors for the string scanning routines. _j_vec_mask turns a comparison result into an integer with
+ * J_SIMD_MASK_BITS bits per byte lane (NEON has no movemask, so it narrows to a nibble per lane instead).
+ * Without a vector unit the width is 0 and the callers take their scalar loops.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define J_SIMD_WIDTH 32
+#define J_SIMD_MASK_BITS 1
+typedef __m256i JVec;
+#define _j_vec_load(p) _mm256_loadu_si256(cast(const __m256i *, (p)))
+#define _j_vec_splat(c) _mm256_set1_epi8(cast(char, (c)))
+#define _j_vec_eq(a, b) _mm256_cmpeq_epi8((a), (b))
+#define _j_vec_and(a, b) _mm256_and_si256((a), (b))
+#define _j_vec_or(a, b) _mm256_or_si256((a), (b))
+#define _j_vec_mask(v) cast(u64, cast(u32, _mm256_movemask_epi8(v)))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define J_SIMD_WIDTH 16
+#define J_SIMD_MASK_BITS 1
+typedef __m128i JVec;
+#define _j_vec_load(p) _mm_loadu_si128(cast(const __m128i *, (p)))
+#define _j_vec_splat(c) _mm_set1_epi8(cast(char, (c)))
+#define _j_vec_eq(a, b) _mm_cmpeq_epi8((a), (b))
+#define _j_vec_and(a, b) _mm_and_si128((a), (b))
+#define _j_vec_or(a, b) _mm_or_si128((a), (b))
+#define _j_vec_mask(v) cast(u64, cast(u32, _mm_movemask_epi8(v)))
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define J_SIMD_WIDTH 16
+#define J_SIMD_MASK_BITS 4
+typedef uint8x16_t JVec;
+#define _j_vec_load(p) vld1q_u8(cast(const u8 *, (p)))
+#define _j_vec_splat(c) vdupq_n_u8(cast(u8, (c)))
+#define _j_vec_eq(a, b) vceqq_u8((a), (b))
+#define _j_vec_and(a, b) vandq_u8((a), (b))
+#define _j_vec_or(a, b) vorrq_u8((a), (b))
+#define _j_vec_mask(v) vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0)
+#else
+#define J_SIMD_WIDTH 0
+#define J_SIMD_MASK_BITS 1
+#endif
+/**
+ * @brief Lane of the lowest set lane in a non zero mask, and the mask without that lane.
+ */
+#define _j_mask_first(mask) (__builtin_ctzll(mask) / J_SIMD_MASK_BITS)
+#define _j_mask_drop_first(mask) ((mask) & ~(((1ull << J_SIMD_MASK_BITS) - 1) << (__builtin_ctzll(mask) & ~(J_SIMD_MASK_BITS - 1))))
+/**
+ * @brief The mask with every lane set, used to invert a mask.
+ */
+#define J_SIMD_FULL_MASK (J_SIMD_WIDTH * J_SIMD_MASK_BITS == 64 ? ~0ull : (1ull << (J_SIMD_WIDTH * J_SIMD_MASK_BITS)) - 1)
+
+
 
 // ======= STRING LIBRARY =======
 
@@ -92,6 +155,9 @@ _j_stamp_pair(Str, Str);
 _j_stamp_maybe(Str);
 _j_stamp_maybe(SubStr);
 _j_stamp_maybe(u32);
+_j_stamp_maybe(u64);
+_j_stamp_maybe(i64);
+_j_stamp_maybe(f64);
 
 _j_stamp_maybe(j_pair(Str, Str));
 
@@ -151,6 +217,21 @@ _j_stamp_maybe(ArenaPtr);
  */
 void *j_alloc(Arena *arena, u64 size_or_count);
 void j_free(Arena *arena, void *ptr, u64 size);
+/**
+ * @brief Grows the allocation at ptr from size to new_size bytes without moving it. This only succeeds when ptr is the last allocation of a linear arena and the arena has room, otherwise it returns false and leaves the arena untouched.
+ */
+bool j_extend(Arena *arena, void *ptr, u64 size, u64 new_size);
+#define _j_align_up(n, align) (((n) + (align) - 1) & ~cast(u64, (align) - 1))
+/**
+ * @brief Allocates size bytes aligned to align, which must be a power of two.
+ *
+ * j_alloc hands out the next bytes of the arena without padding, so a struct or array with fields wider than a byte goes through here instead. On a linear arena only the padding up to the next aligned address is taken and the size is rounded up to align, which keeps an aligned arena aligned for the allocations that follow. Other arenas over-allocate by align - 1 bytes.
+ */
+void *_j_alloc_aligned(Arena *arena, u64 size, u64 align);
+/**
+ * @brief Frees an allocation made by _j_alloc_aligned with the same size and align. Like j_free on a linear arena, this only reclaims the memory when it is the last allocation.
+ */
+void _j_free_aligned(Arena *arena, void *ptr, u64 size, u64 align);
 void j_init_scratch(Arena *program_memory, i32 arena_count, u64 total_scratch_available);
 j_maybe(ArenaPtr) j_get_scratch();
 void j_release_scratch(Arena *scratch);
@@ -178,6 +259,98 @@ Arena j_make_pool(Arena *arena, u64 size, u64 block_size);
 
 typedef Str IStr;
 
+/**
+ * @brief A string that carries its hash, computed once by hstr_from_str. Unequal strings almost always differ in
+ * hash or length, so hstr_eq rarely has to look at the characters.
+ */
+typedef struct HStr {
+    Str str;
+    u64 hash;
+} HStr;
+#define hstr_from_lit(cstr) hstr_from_str(str_from_lit(cstr))
+HStr hstr_from_str(const Str str);
+bool hstr_eq(const HStr a, const HStr b);
+
+#define J_SMALL_STR_INLINE 15
+#define J_SMALL_STR_HEAP 0x80
+
+/**
+ * @brief A 16 byte string that keeps up to J_SMALL_STR_INLINE bytes inline and longer strings in the arena, so
+ * short keys are compared and hashed without touching another cache line. The last byte is the tag:
+ * J_SMALL_STR_INLINE - len while inline, which makes a full inline string end in a NUL, or J_SMALL_STR_HEAP.
+ * Unused inline bytes are zero, so every string has one representation and equality is two word compares.
+ */
+typedef union SmallStr {
+    struct {
+        char chars[J_SMALL_STR_INLINE];
+        u8 tag;
+    };
+    struct {
+        char * _Nullable heap_str;
+        u32 heap_len;
+    };
+    u64 words[2];
+} SmallStr;
+static_assert(sizeof(SmallStr) == 16, "A SmallStr must be 16 bytes");
+
+#define sstr_is_inline(sstr) ((sstr).tag != J_SMALL_STR_HEAP)
+#define sstr_len(sstr) (sstr_is_inline(sstr) ? cast(u32, J_SMALL_STR_INLINE - (sstr).tag) : (sstr).heap_len)
+#define sstr_from_lit(arena, cstr) sstr_from_str(arena, str_from_lit(cstr))
+/**
+ * @brief Stores the string inline when it fits, and otherwise copies it into the arena.
+ */
+SmallStr sstr_from_str(Arena * _Nonnull arena, const Str str);
+/**
+ * @brief A null terminated Str of the characters. For an inline string the view points into the SmallStr itself,
+ * so it is only valid as long as that SmallStr is.
+ */
+Str sstr_view(const SmallStr * _Nonnull sstr);
+bool sstr_eq(const SmallStr a, const SmallStr b);
+bool sstr_eq_str(const SmallStr * _Nonnull a, const Str b);
+/**
+ * @brief Equal to str_hash of the characters, so SmallStr keys can be looked up with a hash computed from a Str.
+ */
+u64 sstr_hash(const SmallStr sstr);
+
+/**
+ * @brief Maps strings to a canonical IStr. Every unique string is copied once into the arena, preceded by an
+ * IStrHeader with its hash and id, so two interned strings are equal exactly when their pointers are equal.
+ * ids are dense, starting at 0, and index the strings list.
+ */
+typedef struct Interner {
+    Arena * _Nonnull arena;
+    j_list(IStr) strings;
+    u32 * _Nullable slots; // id + 1 of the string in the slot, 0 when the slot is empty.
+    u32 slot_cap;
+} Interner;
+
+typedef struct IStrHeader {
+    u64 hash;
+    u32 id;
+    u32 len;
+} IStrHeader;
+
+#define _j_istr_header(istr) (cast(IStrHeader *, (istr).str) - 1)
+/**
+ * @brief Equality, id and hash of interned strings, all O(1).
+ * Precondition: The strings must come from the same interner.
+ */
+#define istr_eq(a, b) ((a).str == (b).str)
+#define istr_id(istr) (_j_istr_header(istr)->id)
+#define istr_hash(istr) (_j_istr_header(istr)->hash)
+
+Interner j_make_interner(Arena * _Nonnull arena);
+/**
+ * @brief Returns the canonical copy of the string, adding it to the interner if it is new.
+ */
+IStr j_intern(Interner * _Nonnull interner, const Str str);
+/**
+ * @brief Returns the canonical copy of the string without adding it.
+ */
+j_maybe(Str) j_interner_find(const Interner * _Nonnull interner, const Str str);
+#define j_interner_len(interner) j_al_len((interner)->strings)
+#define j_interner_get(interner, id) ((interner)->strings[id])
+
 typedef struct FormatOption {
     Str format;
     const Str (* _Nonnull printer)(Arena *arena, va_list * _Nonnull args);
@@ -191,7 +364,15 @@ bool str_start_with(const Str str, const Str prefix);
 const Str str_concat(Arena *arena, const Str prefix, const Str suffix);
 //Str str_from_cstr(const char * _Nonnull cstr);
 bool str_contains(const Str hay, const Str needle);
+/**
+ * @brief Hashes the string eight bytes at a time.
+ */
+u64 str_hash(const Str str);
 Str str_build_from_arraylist(Arena *arena, const j_list(Str) list);
+/**
+ * @brief Concatenates count strings into one null terminated string allocated from the arena.
+ */
+Str str_build_from_array(Arena *arena, const Str * _Nullable strs, u64 count);
 
 const Str __attribute__((overloadable)) str_format(char * _Nonnull format, Arena *arena, ...);
 const Str __attribute__((overloadable)) str_format(const Str format, Arena *arena, ...);
@@ -200,6 +381,99 @@ void str_register(Arena *perm_arena,
                   const char * _Nonnull format,
                   const Str (* _Nonnull printer)(Arena *arena, va_list * _Nonnull args));
 
+// MARK: - String Builder
+
+/**
+ * @brief Builds a Str by appending into a single arena buffer that grows geometrically. On a linear arena the
+ * buffer is extended in place while it is the last allocation, so a builder that owns the top of its arena never
+ * copies what it has written.
+ */
+typedef struct StrBuilder {
+    Arena * _Nonnull arena;
+    char * _Nullable buf;
+    u32 len;
+    u32 cap;
+} StrBuilder;
+
+#define J_SB_INITIAL_CAP 64
+
+StrBuilder j_sb_make(Arena * _Nonnull arena, u32 capacity);
+/**
+ * @brief Makes room for at least n more bytes, so the following appends do not reallocate.
+ */
+void j_sb_reserve(StrBuilder * _Nonnull sb, u32 n);
+void j_sb_append(StrBuilder * _Nonnull sb, const Str str);
+void j_sb_append_char(StrBuilder * _Nonnull sb, char c);
+void j_sb_append_u64(StrBuilder * _Nonnull sb, u64 number);
+void j_sb_append_i64(StrBuilder * _Nonnull sb, i64 number);
+/**
+ * @brief Appends the formatted string, using the same format options as str_format.
+ */
+void j_sb_format(StrBuilder * _Nonnull sb, const Str format, ...);
+/**
+ * @brief Null terminates the buffer and returns it, giving the unused capacity back to the arena when possible.
+ * The builder is left empty and can be reused.
+ */
+Str j_sb_build(StrBuilder * _Nonnull sb);
+#define j_sb_append_lit(sb, lit) j_sb_append(sb, str_from_lit(lit))
+#define j_sb_len(sb) ((sb)->len)
+/**
+ * @brief The characters written so far. The view is invalidated by the next append.
+ */
+#define j_sb_view(sb) ((Str) { .str = (sb)->buf, .len = (sb)->len })
+
+// MARK: - Rope
+
+/**
+ * @brief An immutable string stored as a height balanced tree of Str leaves. Concatenation and slicing create
+ * O(log n) new nodes and share everything else, so neither copies the characters. Leaves reference the strings
+ * they were made from, which must outlive the rope. The empty rope is NULL.
+ */
+typedef struct Rope {
+    const struct Rope * _Nullable left;
+    const struct Rope * _Nullable right;
+    Str leaf; // Only used by leaves, which have no children.
+    u64 len;
+    u32 height;
+} Rope;
+
+/**
+ * @brief Leaves at most this long are merged when concatenated, so appending many small pieces does not produce
+ * a node per piece.
+ */
+#define J_ROPE_LEAF_MERGE 64
+// An AVL tree over 2^64 characters is never taller than this.
+#define J_ROPE_MAX_HEIGHT 96
+
+typedef struct RopeIter {
+    const Rope * _Nullable stack[J_ROPE_MAX_HEIGHT];
+    u32 top;
+} RopeIter;
+
+#define j_rope_len(rope) ((rope) ? (rope)->len : 0)
+
+const Rope * _Nullable j_rope_from_str(Arena * _Nonnull arena, const Str str);
+const Rope * _Nullable j_rope_concat(Arena * _Nonnull arena, const Rope * _Nullable a, const Rope * _Nullable b);
+/**
+ * @brief Returns the characters in [begin, end).
+ * Precondition: begin <= end <= j_rope_len(rope)
+ */
+const Rope * _Nullable j_rope_slice(Arena * _Nonnull arena, const Rope * _Nullable rope, u64 begin, u64 end);
+/**
+ * @brief Precondition: index < j_rope_len(rope)
+ */
+char j_rope_at(const Rope * _Nonnull rope, u64 index);
+/**
+ * @brief Iterates over the leaves of the rope in order, yielding each as a Str.
+ */
+RopeIter j_rope_iter(const Rope * _Nullable rope);
+j_maybe(Str) j_rope_next_chunk(RopeIter * _Nonnull it);
+void j_sb_append_rope(StrBuilder * _Nonnull sb, const Rope * _Nullable rope);
+/**
+ * @brief Copies the rope into one null terminated Str.
+ */
+Str j_rope_flatten(Arena * _Nonnull arena, const Rope * _Nullable rope);
+
 
 /**
  * @brief Returns a substring from the start of the substring up to and including the specified position
@@ -239,6 +513,22 @@ Maybeu32 j_ss_first_index_of_c(SubStr ss, char c);
  * @brief returns the first index of the string in the substring
  */
 Maybeu32 j_ss_first_index_of_str(SubStr ss, Str needle);
+/**
+ * @brief returns the first index of any of the characters in set, e.g. a set of delimiters
+ */
+Maybeu32 j_ss_first_index_of_any(SubStr ss, Str set);
+/**
+ * @brief returns the length of the prefix that only consists of characters in set
+ */
+u32 j_ss_span(SubStr ss, Str set);
+/**
+ * @brief Returns the prefix that only consists of characters in set
+ */
+SubStr j_ss_prefix_while_in(SubStr ss, Str set);
+/**
+ * @brief Removes the characters in set from the front of the substring
+ */
+void j_ss_remove_while_in(SubStr *ss, Str set);
 
 /**
  * @brief Returns the substring up to, but not including, the seperator and removes it from the substring
@@ -254,6 +544,137 @@ MaybeSubStr j_ss_split_on_first_str(SubStr *ss, Str seperator);
  */
 void j_ss_trim_front_whitespace(SubStr *ss);
 
+// MARK: - Tokenizer
+
+#define J_TOK_BLOCK (J_SIMD_WIDTH ? J_SIMD_WIDTH : 64)
+
+/**
+ * @brief Splits a buffer into lines and delimited fields in a single pass, without copying. Each block of input is
+ * classified once into a bitmask of delimiter and newline positions, and the fields are read off the mask.
+ * The fields are SubStr views into the input, so the buffer (e.g. a mapped file) must outlive them.
+ * A trailing \r before the newline is not part of the last field. Quoting is not supported.
+ */
+typedef struct Tokenizer {
+    SubStr input;
+    char delimiter;
+    bool at_line_end;
+    bool done;
+    u64 pos;
+    u64 block;
+    u64 mask;
+} Tokenizer;
+
+Tokenizer j_tok_make(SubStr input, char delimiter);
+/**
+ * @brief Returns the next field. j_tok_at_line_end tells whether it was the last field of its line.
+ */
+MaybeSubStr j_tok_next_field(Tokenizer * _Nonnull tok);
+/**
+ * @brief Returns the rest of the current line, without the newline, and moves to the next line.
+ */
+MaybeSubStr j_tok_next_line(Tokenizer * _Nonnull tok);
+#define j_tok_at_line_end(tok) ((tok)->at_line_end)
+
+// MARK: - UTF-8
+
+/**
+ * @brief Returns true when the string is well formed UTF-8, i.e. it has no overlong encodings, surrogates, code
+ * points above U+10FFFF, stray continuation bytes or truncated sequences.
+ * Where the target has a byte shuffle (AVX2, SSSE3, AArch64) this runs the lookup table algorithm of Keiser and
+ * Lemire a vector at a time. Otherwise it skips ASCII sixteen bytes at a time and decodes the rest.
+ */
+bool str_utf8_valid(const Str str);
+/**
+ * @brief Number of code points in the string.
+ * Precondition: The string must be valid UTF-8, as every byte that is not a continuation byte is counted.
+ */
+u64 str_utf8_count(const Str str);
+#define j_ss_utf8_valid(ss) str_utf8_valid((ss).str)
+#define j_ss_utf8_count(ss) str_utf8_count((ss).str)
+/**
+ * @brief Length of the sequence started by the lead byte, or 0 if the byte can not start a sequence.
+ */
+u32 j_utf8_seq_len(u8 lead);
+
+#define J_UTF8_REPLACEMENT 0xFFFDu
+
+/**
+ * @brief Decodes the code points of a SubStr one at a time. Ill formed input decodes to J_UTF8_REPLACEMENT,
+ * one per maximal invalid subpart as Unicode recommends, so the iterator always makes progress.
+ * pos is the byte offset of the next code point.
+ */
+typedef struct Utf8Iter {
+    SubStr input;
+    u32 pos;
+} Utf8Iter;
+
+#define j_utf8_iter(ss) ((Utf8Iter) { .input = (ss), .pos = 0 })
+j_maybe(u32) j_utf8_next(Utf8Iter * _Nonnull it);
+
+// MARK: - Number Parsing
+
+/**
+ * @brief Parses the whole SubStr as a decimal number, without copying or NUL terminating it. An optional sign
+ * is accepted, anything else that is not part of the number (whitespace included) makes the parse fail, as
+ * does an integer that does not fit the type. Eight digits are converted at a time.
+ */
+j_maybe(u64) j_ss_parse_u64(SubStr ss);
+j_maybe(i64) j_ss_parse_i64(SubStr ss);
+/**
+ * @brief Parses [+-]digits[.digits][(e|E)[+-]digits], where either side of the point may be empty but not both,
+ * rounding to the nearest double. Uses the Clinger fast path when the result is exact, and the Eisel-Lemire
+ * algorithm otherwise. Inputs with more than 19 significant digits that Eisel-Lemire can not round fall back
+ * to strtod.
+ */
+j_maybe(f64) j_ss_parse_f64(SubStr ss);
+
+// MARK: - Multi Pattern Matching
+
+/**
+ * @brief An Aho-Corasick automaton compiled from a list of needles, which finds every occurrence of every needle
+ * in one pass over the haystack. Bytes that occur in no needle share a class, and the transitions are a flat
+ * state by class table, so each haystack byte costs two loads. Entries hold the target row offset, with the top
+ * bit set when the target state ends a needle.
+ * With ignore_ascii_case, A-Z and a-z fall in the same classes, so folding costs nothing while scanning.
+ */
+typedef struct AhoCorasick {
+    u32 * _Nonnull table;
+    u16 byte_class[256]; // Wider than a byte, since class 0 plus all 256 bytes in use makes 257 classes.
+    u32 class_count;
+    u32 state_count;
+    u32 * _Nonnull state_pattern;  // First needle ending in the state, or UINT32_MAX.
+    u32 * _Nonnull next_output;    // Next state ending a needle along the suffix links of an output state, or 0.
+    u32 * _Nonnull output;         // The state itself if it ends a needle, else its nearest such suffix, or 0.
+    u32 * _Nonnull pattern_next;   // Next needle equal to this one, or UINT32_MAX.
+    u32 * _Nonnull pattern_lens;
+    u32 pattern_count;
+} AhoCorasick;
+
+typedef struct AcMatch {
+    u32 pattern; // Index of the needle in the list the automaton was built from.
+    u32 start;
+    u32 end;
+} AcMatch;
+_j_stamp_maybe(AcMatch);
+
+#define J_AC_OUTPUT_BIT 0x80000000u
+
+/**
+ * @brief Compiles the needles into an automaton allocated from the arena.
+ * Precondition: The needles must not be empty.
+ */
+AhoCorasick j_make_aho_corasick(Arena * _Nonnull arena, const j_list(Str) needles, bool ignore_ascii_case);
+/**
+ * @brief Returns every match, including overlapping ones, ordered by end position and longest first for matches
+ * that end together.
+ */
+j_list(AcMatch) j_ac_find_all(const AhoCorasick * _Nonnull ac, Arena * _Nonnull arena, const Str hay);
+/**
+ * @brief Returns the match that ends first, stopping the scan there.
+ */
+j_maybe(AcMatch) j_ac_find_first(const AhoCorasick * _Nonnull ac, const Str hay);
+#define j_ac_contains_any(ac, hay) (j_ac_find_first(ac, hay).is_present)
+
 typedef enum J_RB_COLOR {
     J_RB_RED,
     J_RB_BLACK,
@@ -273,6 +694,8 @@ typedef struct RBTreeHeader {
     j_maybe(u32) * _Nullable left_child_for;
     j_maybe(u32) * _Nullable right_child_for;
     J_RB_COLOR * _Nullable color_for;
+    // Number of nodes in the subtree rooted at each node. NULL unless enabled with j_rb_enable_rank.
+    u32 * _Nullable size_for;
 
     // 0 -> Equal
     // - -> Left is less
@@ -295,9 +718,11 @@ typedef struct RBTreeHeader {
 #define j_rb_parent(tree, descriptor) (j_rb_header(tree)->parent_for[descriptor])
 #define _j_rb_parent(tree, descriptor) (j_rb_header(tree)->parent_for[descriptor].value)
 #define j_rb_color(tree, descriptor) (j_rb_header(tree)->color_for[descriptor])
-#define _j_rb_init(tree, compare_function) ({   \
+#define j_rb_size(tree, mdescriptor) ((mdescriptor).is_present ? j_rb_header(tree)->size_for[(mdescriptor).value] : 0)
+#define _j_rb_init(tree, compare_function) _j_rb_init_cap(tree, compare_function, 10)
+#define _j_rb_init_cap(tree, compare_function, capacity) ({   \
     if ((tree) == EMPTY_RB) { \
-        u32 cap = 10;         \
+        u32 cap = (capacity); \
         (tree) = malloc(sizeof(RBTreeHeader) + sizeof(tree[0]) * cap) + sizeof(RBTreeHeader);\
         j_rb_header(tree)->len = 0;  \
         j_rb_header(tree)->cap = cap;\
@@ -306,6 +731,7 @@ typedef struct RBTreeHeader {
         j_rb_header(tree)->left_child_for = calloc(cap, sizeof(j_maybe(u32)));   \
         j_rb_header(tree)->right_child_for = calloc(cap, sizeof(j_maybe(u32)));  \
         j_rb_header(tree)->color_for = calloc(cap, sizeof(J_RB_COLOR)); \
+        j_rb_header(tree)->size_for = NULL; \
         j_rb_header(tree)->compare_func = (compare_function);\
     }                       \
 })
@@ -332,6 +758,9 @@ typedef struct RBTreeHeader {
         } \
     }) \
     if (result.is_present == false) { \
+        if (j_rb_len(tree) == j_rb_cap(tree)) { \
+            (tree) = _j_rb_grow(tree, sizeof(tree[0])); \
+        } \
         u32 current = j_rb_header(tree)->len++; \
         mcurrent.is_present = true; \
         mcurrent.value = current; \
@@ -347,6 +776,7 @@ typedef struct RBTreeHeader {
             j_rb_header(tree)->root = mcurrent; \
         } \
         j_rb_color(tree, current) = J_RB_RED; \
+        _j_rb_grow_path(tree, current); \
         _j_rb_insert_fixup(tree, current); \
         result.value.first = current;\
         result.value.second = true;\
@@ -376,450 +806,3585 @@ typedef struct RBTreeHeader {
 #define _j_rb_left_sibling(tree, u) (j_rb_left(tree, j_rb_parent(tree, u).value))
 #define _j_rb_right_sibling(tree, u) (j_rb_right(tree, j_rb_parent(tree, u).value))
 #define _j_rb_grandparent(tree, u) (j_rb_parent(tree, j_rb_parent(tree, u).value).value)
-#define _j_rb_transplant(tree, u, v) ({ \
+#define _j_rb_transplant(tree, u, mv) ({ \
+    j_maybe(u32) transplanted = (mv).is_present ? (mv) : ((j_maybe(u32)) { .is_present = false }); \
     if (j_rb_parent(tree, u).is_present == false) { \
-        j_rb_root(tree) = ((j_maybe(u32)) { .is_present = true, .value = v }); \
+        j_rb_root(tree) = transplanted; \
     } else if (_j_rb_is_left_sibling(tree, u)) { \
-        _j_rb_left_sibling(tree, u) = ((j_maybe(u32)) { .is_present = true, .value = v }); \
+        _j_rb_left_sibling(tree, u) = transplanted; \
     } else { \
-        _j_rb_right_sibling(tree, u) = ((j_maybe(u32)) { .is_present = true, .value = v }); \
+        _j_rb_right_sibling(tree, u) = transplanted; \
     } \
-    j_rb_parent(tree, v) = j_rb_parent(tree, u); \
+    if_let(v, transplanted, { \
+        j_rb_parent(tree, v) = j_rb_parent(tree, u); \
+    }) \
 })
 
 void _j_rb_left_rotate(void *tree, u32 descriptor);
 void _j_rb_right_rotate(void *tree, u32 descriptor);
 void _j_rb_insert_fixup(void *tree, u32 descriptor);
-void _j_rb_delete_fixup(void *tree, u32 descriptor);
+void _j_rb_delete_fixup(void *tree, j_maybe(u32) descriptor, j_maybe(u32) parent);
 void j_rb_delete(void *tree, u32 descriptor);
+j_maybe(u32) _j_rb_minimum(void *tree, j_maybe(u32) descriptor);
+j_maybe(u32) _j_rb_successor(void *tree, u32 descriptor);
+void _j_rb_link_bfs(void *tree, u32 n);
+void _j_rb_grow_path(void *tree, u32 descriptor);
+void _j_rb_update_size(void *tree, j_maybe(u32) descriptor);
+void _j_rb_enable_rank(void *tree);
+/**
+ * @brief Doubles the capacity of a full tree and returns the moved tree. Descriptors stay valid.
+ */
+void *_j_rb_grow(void *tree, size_t node_size);
 
-#define EMPTY_ARRAY NULL
-// MARK: - ArrayList New
-//#define j_list(type) J_LIST(type)
-
-typedef struct ArrHeader {
-    u64 len;
-    u64 cap;
-} ArrHeader;
+/**
+ * @brief Augments the tree with subtree sizes so j_rb_rank and j_rb_select run in O(log n).
+ * The sizes are maintained by every later put, delete and rotation.
+ */
+#define j_rb_enable_rank(tree) ({ \
+    _j_rb_init(tree, j_rb_u32_comp); \
+    _j_rb_enable_rank(tree); \
+})
 
-#define j_al_header(list) ((list) ? cast(ArrHeader *, list) - 1 : EMPTY_ARRAY)
-#define j_al_len(list) ((list) ? j_al_header(list)->len : 0)
-#define j_al_cap(list) ((list) ? j_al_header(list)->cap : 0)
-#define _j_al_init(list, arena) ({\
-    if ((list) == EMPTY_ARRAY) {  \
-        (list) = j_alloc(arena, sizeof(list[0]) * 10 + sizeof(ArrHeader)) + sizeof(ArrHeader); \
-        j_al_header(list)->len = 0;                                                                   \
-        j_al_header(list)->cap = 10;                                                                  \
-    }                             \
+/**
+ * @brief Returns the number of keys in the tree that are less than the key. The key does not have to be in the tree.
+ * Precondition: The tree must have been augmented with j_rb_enable_rank.
+ */
+#define j_rb_rank(tree, key) ({ \
+    jassert(j_rb_header(tree)->size_for != NULL, "Precondition: Call j_rb_enable_rank before j_rb_rank\n"); \
+    j_maybe(u32) mcurrent = j_rb_root(tree); \
+    u32 rank = 0; \
+    while_let(current, mcurrent, { \
+        i32 compare_result = j_rb_compare(tree, key, j_rb_key(tree, current)); \
+        if (compare_result == 0) { \
+            rank += j_rb_size(tree, j_rb_left(tree, current)); \
+            break; \
+        } else if (compare_result < 0) { \
+            mcurrent = j_rb_left(tree, current); \
+        } else { \
+            rank += j_rb_size(tree, j_rb_left(tree, current)) + 1; \
+            mcurrent = j_rb_right(tree, current); \
+        } \
+    }) \
+    rank; \
 })
-#define _j_al_realloc(list, arena) ({ \
-    if (j_al_len(list) == j_al_cap(list)) { \
-        u64 new_cap = j_al_cap(list)*2;     \
-        u64 size = j_al_len(list);    \
-        typeof(list) ptr = j_alloc(arena, sizeof(list[0]) * new_cap + sizeof(ArrHeader)) + sizeof(ArrHeader); \
-        memcpy(ptr, list, sizeof(list[0]) * j_al_cap(list));\
-        j_free(arena, j_al_header(list), sizeof(list[0]) * j_al_cap(list) + sizeof(ArrHeader));     \
-        list = ptr;                   \
-        j_al_header(list)->cap = new_cap;   \
-        j_al_header(list)->len = size;\
-    }                                 \
+
+/**
+ * @brief Returns the descriptor of the k-th smallest key, counting from 0, or nil if the tree has no more than k keys.
+ * Precondition: The tree must have been augmented with j_rb_enable_rank.
+ */
+j_maybe(u32) j_rb_select(void *tree, u32 k);
+
+/**
+ * @brief Returns the descriptor of the smallest key in the tree, or nil if the tree is empty.
+ */
+#define j_rb_iter(tree) ((tree) ? _j_rb_minimum(tree, j_rb_root(tree)) : ((j_maybe(u32)) NIL))
+/**
+ * @brief Returns the descriptor following the descriptor in key order, or nil if it was the last.
+ */
+#define j_rb_iter_next(tree, it) (_j_rb_successor(tree, (it).value))
+
+/**
+ * @brief Builds the tree from n keys in strictly ascending order in O(n) time without any rotations.
+ * The nodes are laid out in BFS order, so descriptor 0 is the root and the children of d are 2d+1 and 2d+2.
+ * Every level is black except for a partially filled last level, which is red.
+ * The tree is allocated with exactly n nodes. Later puts grow it like any other tree.
+ * Precondition: The tree must be empty.
+ */
+#define j_rb_build_sorted(tree, keys, values, n) ({ \
+    jassert((tree) == EMPTY_RB, "Precondition: The tree must be empty before building it\n"); \
+    u32 j_rb_n = (n); \
+    _j_rb_init_cap(tree, j_rb_u32_comp, j_rb_n); \
+    _j_rb_link_bfs(tree, j_rb_n); \
+    /* Walk the BFS indices in order and hand out the keys by rank. */ \
+    u64 j_rb_stack[64]; \
+    u32 j_rb_top = 0; \
+    u64 j_rb_node = 0; \
+    u32 j_rb_next_key = 0; \
+    while (j_rb_node < j_rb_n || j_rb_top > 0) { \
+        while (j_rb_node < j_rb_n) { \
+            j_rb_stack[j_rb_top++] = j_rb_node; \
+            j_rb_node = 2 * j_rb_node + 1; \
+        } \
+        j_rb_node = j_rb_stack[--j_rb_top]; \
+        jassert(j_rb_next_key == 0 || j_rb_compare(tree, (keys)[j_rb_next_key - 1], (keys)[j_rb_next_key]) < 0, "Precondition: The keys must be sorted and unique\n"); \
+        tree[j_rb_node] = (typeof(tree[0])) { .first = (keys)[j_rb_next_key], .second = (values)[j_rb_next_key] }; \
+        j_rb_next_key++; \
+        j_rb_node = 2 * j_rb_node + 2; \
+    } \
 })
-#define j_al_append(list, arena, elem) ({ \
-    _j_al_init(list, arena);              \
-    _j_al_realloc(list, arena);           \
-    list[j_al_len(list)] = (elem);        \
-    j_al_header(list)->len += 1;          \
+
+/**
+ * @brief Merges lhs and rhs into tree in O(n + m) time. The values of rhs win when a key is present in both trees.
+ * Neither lhs nor rhs are modified.
+ * Precondition: The tree must be empty.
+ */
+#define j_rb_merge(tree, lhs, rhs) ({ \
+    u32 j_rb_total = j_rb_len(lhs) + j_rb_len(rhs); \
+    typeof((tree)[0].first) *j_rb_keys = malloc(sizeof(j_rb_keys[0]) * j_rb_total); \
+    typeof((tree)[0].second) *j_rb_values = malloc(sizeof(j_rb_values[0]) * j_rb_total); \
+    u32 j_rb_count = 0; \
+    j_maybe(u32) j_rb_l = j_rb_iter(lhs); \
+    j_maybe(u32) j_rb_r = j_rb_iter(rhs); \
+    while (j_rb_l.is_present || j_rb_r.is_present) { \
+        i32 j_rb_order; \
+        if (j_rb_l.is_present == false) { \
+            j_rb_order = 1; \
+        } else if (j_rb_r.is_present == false) { \
+            j_rb_order = -1; \
+        } else { \
+            j_rb_order = j_rb_compare(lhs, j_rb_key(lhs, j_rb_l.value), j_rb_key(rhs, j_rb_r.value)); \
+        } \
+        if (j_rb_order < 0) { \
+            j_rb_keys[j_rb_count] = j_rb_key(lhs, j_rb_l.value); \
+            j_rb_values[j_rb_count] = j_rb_value(lhs, j_rb_l.value); \
+            j_rb_l = j_rb_iter_next(lhs, j_rb_l); \
+        } else { \
+            j_rb_keys[j_rb_count] = j_rb_key(rhs, j_rb_r.value); \
+            j_rb_values[j_rb_count] = j_rb_value(rhs, j_rb_r.value); \
+            if (j_rb_order == 0) { \
+                j_rb_l = j_rb_iter_next(lhs, j_rb_l); \
+            } \
+            j_rb_r = j_rb_iter_next(rhs, j_rb_r); \
+        } \
+        j_rb_count++; \
+    } \
+    j_rb_build_sorted(tree, j_rb_keys, j_rb_values, j_rb_count); \
+    free(j_rb_keys); \
+    free(j_rb_values); \
 })
-#define j_al_swap(list, i, j) do \
-{                               \
-    typeof(list[i]) temp = list[i]; \
-    list[i] = list[j];            \
-    list[j] = temp;               \
-} while(0)
-#define j_al_removeLast(list) (j_al_header(list)->len -= 1, list[j_al_len(list)])
-#define j_al_removeFirst(list) (memmove(list, list+1, sizeof(list[0]) * (j_al_len(list)-1)), j_al_header(list)->len -= 1)
-#define j_al_last(list) ((list)[j_al_len(list)-1])
 
+// MARK: - B+ Tree
 
+// Every node occupies J_BTREE_NODE_SIZE bytes (four cache lines). The fanout is derived from the key and value sizes.
+#define J_BTREE_NODE_SIZE 256
+#define J_BTREE_MAX_HEIGHT 32
+#define EMPTY_BTREE NULL
 
+/**
+ * @brief A node in the B+ tree. The keys are stored contiguously directly after the node,
+ * followed by either the values (leaves) or the child pointers (inner nodes).
+ */
+typedef struct BTreeNode {
+    u16 count;
+    bool is_leaf;
+    struct BTreeNode * _Nullable next; // Next leaf in key order. Only used by leaves.
+} BTreeNode;
 
+typedef struct BTreeHeader {
+    u32 len;
+    u32 height;
+    BTreeNode * _Nullable root;
+    u32 key_size;
+    u32 value_size;
+    u32 leaf_cap;
+    u32 inner_cap;
+    u32 values_offset;   // Offset from the start of a leaf to its values.
+    u32 children_offset; // Offset from the start of an inner node to its children.
+} BTreeHeader;
 
 /**
- * @brief Skips the elements from the substring that satisfies the predicate
+ * @brief A position of an entry inside the B+ tree. It plays the same role as the descriptor of j_rb,
+ * but is only valid until the next call to j_btree_put or j_btree_delete.
  */
-#define j_ss_remove_while(ss, pred) do { \
-    char j_ss_it;                                   \
-    while ((ss)->str.len > 0 && (j_ss_it = *(ss)->str.str, (pred))) { \
-        j_ss_remove_first(ss);                                  \
-    }\
-} while(0)
+typedef struct BTreeCursor {
+    BTreeNode * _Nullable leaf;
+    u32 index;
+} BTreeCursor;
 
+_j_stamp_maybe(BTreeCursor);
 
 /**
- * @brief returns the first index where the predicate is true
+ * @brief An ordered map stored as a B+ tree. The keys must be arithmetic types, they are compared inline with < and ==
+ * such that the search inside a node is a branchless linear scan that the compiler can vectorise.
+ * The leaves are linked in key order, so range scans walk contiguous memory instead of chasing parent pointers.
+ * Deletion borrows from or merges with a sibling, so every node except the root stays at least half full.
  */
-#define j_ss_first_index_where(ss, pred) ({ \
-    Str j_ss_it = (ss).str; \
-    u32 j_ss_index = 0; \
-    while (j_ss_index < (ss).str.len && !(pred)) { \
-        j_ss_index++;                       \
-        j_ss_it.str++;                      \
-        j_ss_it.len--;                      \
+#define j_btree(key, value) j_pair(key, value) * _Nullable
+#define j_btree_header(tree) (cast(BTreeHeader *, tree)-1)
+#define j_btree_len(tree) ((tree) ? j_btree_header(tree)->len : 0)
+#define j_btree_height(tree) ((tree) ? j_btree_header(tree)->height : 0)
+#define _j_btree_keys(node) (cast(void *, cast(u8 *, node) + sizeof(BTreeNode)))
+#define _j_btree_values(header, node) (cast(void *, cast(u8 *, node) + (header)->values_offset))
+#define _j_btree_children(header, node) (cast(BTreeNode **, cast(u8 *, node) + (header)->children_offset))
+#define j_btree_key(tree, cursor) (cast(typeof((tree)[0].first) *, _j_btree_keys((cursor).leaf))[(cursor).index])
+#define j_btree_value(tree, cursor) (cast(typeof((tree)[0].second) *, _j_btree_values(j_btree_header(tree), (cursor).leaf))[(cursor).index])
+#define _j_btree_init(tree) ({ \
+    if ((tree) == EMPTY_BTREE) { \
+        (tree) = malloc(sizeof(BTreeHeader) + sizeof(tree[0])) + sizeof(BTreeHeader); \
+        _j_btree_init_header(j_btree_header(tree), sizeof(tree[0].first), sizeof(tree[0].second)); \
     } \
-    j_ss_index; \
 })
 
 /**
- * @brief Returns a substring from the start of the substring up until the predicate returns false.
+ * @brief Counts the keys in the node that satisfy `keys[i] op key`. The loop has no early exit, so it compiles to a branchless (SIMD) scan.
  */
-#define j_ss_prefix_while(ss, pred) ({ \
-    SubStr temp = (ss);                \
-    temp.str.len = 0;                  \
-    char j_ss_it;                      \
-    while (temp.str.len < (ss).str.len && (j_ss_it = temp.str.str[temp.str.len], (pred))) { \
-        temp.str.len++;                \
-    }                                  \
-    temp;                              \
+#define _j_btree_rank(keys, count, key, op) ({ \
+    u32 j_bt_rank = 0; \
+    for (u32 j_bt_k = 0; j_bt_k < (count); j_bt_k++) { \
+        j_bt_rank += (keys)[j_bt_k] op (key); \
+    } \
+    j_bt_rank; \
 })
 
 /**
- * @brief resets the SubString to the original String
+ * @brief Returns the leaf in which the key belongs.
  */
-#define j_ss_reset(ss) (ss).str = *(ss).base
+#define _j_btree_find_leaf(tree, key) ({ \
+    BTreeHeader *j_bt_header = j_btree_header(tree); \
+    BTreeNode *j_bt_node = j_bt_header->root; \
+    while (j_bt_node->is_leaf == false) { \
+        u32 j_bt_child = _j_btree_rank(cast(typeof((tree)[0].first) *, _j_btree_keys(j_bt_node)), j_bt_node->count, key, <=); \
+        j_bt_node = _j_btree_children(j_bt_header, j_bt_node)[j_bt_child]; \
+    } \
+    j_bt_node; \
+})
 
+/**
+ * @brief Inserts or updates the key in the tree.
+ * @return true if the key was inserted, false if an existing value was updated.
+ */
+#define j_btree_put(tree, key, val) ({ \
+    _j_btree_init(tree); \
+    BTreeHeader *j_bt_header = j_btree_header(tree); \
+    tree[0] = (typeof(tree[0])) { .first = (key), .second = (val) }; \
+    BTreeNode *j_bt_path[J_BTREE_MAX_HEIGHT]; \
+    u32 j_bt_slot[J_BTREE_MAX_HEIGHT]; \
+    u32 j_bt_depth = 0; \
+    BTreeNode *j_bt_node = j_bt_header->root; \
+    while (j_bt_node->is_leaf == false) { \
+        u32 j_bt_child = _j_btree_rank(cast(typeof(tree[0].first) *, _j_btree_keys(j_bt_node)), j_bt_node->count, tree[0].first, <=); \
+        j_bt_path[j_bt_depth] = j_bt_node; \
+        j_bt_slot[j_bt_depth] = j_bt_child; \
+        j_bt_depth++; \
+        j_bt_node = _j_btree_children(j_bt_header, j_bt_node)[j_bt_child]; \
+    } \
+    typeof(tree[0].first) *j_bt_keys = _j_btree_keys(j_bt_node); \
+    u32 j_bt_index = _j_btree_rank(j_bt_keys, j_bt_node->count, tree[0].first, <); \
+    bool j_bt_inserted = true; \
+    if (j_bt_index < j_bt_node->count && j_bt_keys[j_bt_index] == tree[0].first) { \
+        cast(typeof(tree[0].second) *, _j_btree_values(j_bt_header, j_bt_node))[j_bt_index] = tree[0].second; \
+        j_bt_inserted = false; \
+    } else { \
+        _j_btree_insert_at(j_bt_header, j_bt_path, j_bt_slot, j_bt_depth, j_bt_node, j_bt_index, &tree[0].first, &tree[0].second); \
+    } \
+    j_bt_inserted; \
+})
 
-enum J_FS_WALK_OPTIONS {
-    J_FS_WALK_INCLUDE_FOLDER,
-    J_FS_WALK_INCLUDE_REGULAR,
-    J_FS_WALK_ORDER_LEXICOGRAPHIC, // TODO: William Implement me
-    J_FS_WALK_COUNT_FOLDER_ENTRIES, // TODO: William Implement me
-    J_FS_WALK_INCLUDE_DOT, // TODO: William Implement me
-    J_FS_WALK_INCLUDE_DOTDOT, // TODO: William Implement me
+/**
+ * @brief Returns a cursor to the first entry whose key is not less than the key. Use it as the start of a range scan.
+ */
+#define j_btree_lower_bound(tree, key) ({ \
+    j_maybe(BTreeCursor) j_bt_result = NIL; \
+    if ((tree) != EMPTY_BTREE) { \
+        typeof((tree)[0].first) j_bt_key = (key); \
+        BTreeNode *j_bt_leaf = _j_btree_find_leaf(tree, j_bt_key); \
+        u32 j_bt_index = _j_btree_rank(cast(typeof((tree)[0].first) *, _j_btree_keys(j_bt_leaf)), j_bt_leaf->count, j_bt_key, <); \
+        j_bt_result = _j_btree_normalize((BTreeCursor) { .leaf = j_bt_leaf, .index = j_bt_index }); \
+    } \
+    j_bt_result; \
+})
+
+/**
+ * @brief Returns a cursor to the entry with the key, or nil if the key is not in the tree.
+ */
+#define j_btree_find(tree, key) ({ \
+    j_maybe(BTreeCursor) j_bt_found = NIL; \
+    if ((tree) != EMPTY_BTREE) { \
+        typeof((tree)[0].first) j_bt_key = (key); \
+        BTreeNode *j_bt_leaf = _j_btree_find_leaf(tree, j_bt_key); \
+        typeof((tree)[0].first) *j_bt_keys = _j_btree_keys(j_bt_leaf); \
+        u32 j_bt_index = _j_btree_rank(j_bt_keys, j_bt_leaf->count, j_bt_key, <); \
+        if (j_bt_index < j_bt_leaf->count && j_bt_keys[j_bt_index] == j_bt_key) { \
+            j_bt_found.is_present = true; \
+            j_bt_found.value = (BTreeCursor) { .leaf = j_bt_leaf, .index = j_bt_index }; \
+        } \
+    } \
+    j_bt_found; \
+})
+
+#define j_btree_iter(tree) ((tree) ? _j_btree_first(j_btree_header(tree)) : ((j_maybe(BTreeCursor)) NIL))
+#define j_btree_iter_next(tree, it) (_j_btree_normalize((BTreeCursor) { .leaf = (it).value.leaf, .index = (it).value.index + 1 }))
+
+void _j_btree_init_header(BTreeHeader *header, u32 key_size, u32 value_size);
+void _j_btree_insert_at(BTreeHeader *header, BTreeNode * _Nonnull * _Nonnull path, u32 * _Nonnull slot, u32 depth, BTreeNode *leaf, u32 index, const void *key, const void *value);
+j_maybe(BTreeCursor) _j_btree_first(BTreeHeader *header);
+j_maybe(BTreeCursor) _j_btree_normalize(BTreeCursor cursor);
+/**
+ * @brief Removes the entry at the cursor from the tree. All cursors into the tree are invalidated.
+ */
+#define j_btree_delete(tree, cursor) ({ \
+    BTreeHeader *j_bt_header = j_btree_header(tree); \
+    BTreeCursor j_bt_cursor = (cursor); \
+    jassert(j_bt_cursor.index < j_bt_cursor.leaf->count, "Precondition: The cursor must point to an entry in the tree\n"); \
+    typeof((tree)[0].first) j_bt_key = j_btree_key(tree, j_bt_cursor); \
+    /* Walk down to the leaf again to record the path that the rebalancing climbs back up. */ \
+    BTreeNode *j_bt_path[J_BTREE_MAX_HEIGHT]; \
+    u32 j_bt_slot[J_BTREE_MAX_HEIGHT]; \
+    u32 j_bt_depth = 0; \
+    BTreeNode *j_bt_node = j_bt_header->root; \
+    while (j_bt_node->is_leaf == false) { \
+        u32 j_bt_child = _j_btree_rank(cast(typeof((tree)[0].first) *, _j_btree_keys(j_bt_node)), j_bt_node->count, j_bt_key, <=); \
+        j_bt_path[j_bt_depth] = j_bt_node; \
+        j_bt_slot[j_bt_depth] = j_bt_child; \
+        j_bt_depth++; \
+        j_bt_node = _j_btree_children(j_bt_header, j_bt_node)[j_bt_child]; \
+    } \
+    jassert(j_bt_node == j_bt_cursor.leaf, "Precondition: The cursor must point to an entry in the tree\n"); \
+    _j_btree_delete_at(j_bt_header, j_bt_path, j_bt_slot, j_bt_depth, j_bt_cursor.leaf, j_bt_cursor.index); \
+})
+void _j_btree_delete_at(BTreeHeader *header, BTreeNode * _Nonnull * _Nonnull path, u32 * _Nonnull slot, u32 depth, BTreeNode *leaf, u32 index);
+/**
+ * @brief Releases all the nodes of the tree.
+ */
+void j_btree_free(void *tree);
+
+// MARK: - Persistent Red Black Tree
+
+/**
+ * @brief A node in the persistent red black tree. Nodes are never modified after they are published,
+ * the key and value are stored directly after the node.
+ */
+typedef struct PRBNode {
+    struct PRBNode * _Nullable left;
+    struct PRBNode * _Nullable right;
+    J_RB_COLOR color;
+} PRBNode;
+
+typedef PRBNode * PRBNodePtr;
+_j_stamp_maybe(PRBNodePtr);
+
+/**
+ * @brief The tree as seen by a reader. It stays valid until it is passed to j_prb_read_end.
+ */
+typedef struct PRBVersion {
+    PRBNode * _Nullable root;
+    u64 epoch;
+} PRBVersion;
+
+/**
+ * The writer allocates the nodes of the current version from arenas[active]. j_prb_compact copies the live version
+ * into the other arena, waits for the readers of the old epoch to leave and then resets the old arena.
+ */
+typedef struct PRBTreeHeader {
+    PRBNode * _Nullable _Atomic root;
+    _Atomic u64 epoch;
+    _Atomic u32 readers[2];
+    Arena * _Nonnull arenas[2];
+    u32 active; // Only touched by the writer.
+    _Atomic u32 len; // Only written by the writer, but readers may load it concurrently.
+    u32 key_size;
+    u32 value_size;
+    u32 value_offset;
+    u32 node_size;
+    // 0 -> Equal
+    // - -> Left is less
+    // + -> Left is greater
+    i32 (* _Nonnull compare_func)(const void *lhs, const void *rhs);
+} PRBTreeHeader;
+
+/**
+ * @brief A persistent (copy on write) red black tree with a single writer and any number of lock free readers.
+ * Every put and delete copies the path from the root to the changed node and publishes a new root atomically,
+ * all untouched subtrees are shared with the previous version.
+ */
+#define j_prb(key, value) j_pair(key, value) * _Nullable
+#define EMPTY_PRB NULL
+#define j_prb_header(tree) (cast(PRBTreeHeader *, tree)-1)
+#define j_prb_len(tree) ((tree) ? atomic_load_explicit(&j_prb_header(tree)->len, memory_order_relaxed) : 0)
+#define j_prb_key(tree, node) (*cast(typeof((tree)[0].first) *, cast(u8 *, node) + sizeof(PRBNode)))
+#define j_prb_value(tree, node) (*cast(typeof((tree)[0].second) *, cast(u8 *, node) + j_prb_header(tree)->value_offset))
+
+/**
+ * @brief Creates the tree. Both arenas must use the linear allocation scheme and are owned by the tree from now on.
+ */
+#define j_prb_init(tree, arena, other_arena, compare_function) ({ \
+    if ((tree) == EMPTY_PRB) { \
+        (tree) = malloc(sizeof(PRBTreeHeader) + sizeof(tree[0])) + sizeof(PRBTreeHeader); \
+        _j_prb_init_header(j_prb_header(tree), arena, other_arena, sizeof(tree[0].first), sizeof(tree[0].second), compare_function); \
+    } \
+})
+
+/**
+ * @brief Publishes a new version with the key inserted or updated. Must only be called by the writer.
+ * @return true if the key was inserted, false if an existing value was updated.
+ */
+#define j_prb_put(tree, key, val) ({ \
+    tree[0] = (typeof(tree[0])) { .first = (key), .second = (val) }; \
+    _j_prb_put(j_prb_header(tree), &tree[0].first, &tree[0].second); \
+})
+
+/**
+ * @brief Publishes a new version without the key. Must only be called by the writer.
+ * @return false if the key was not in the tree.
+ */
+#define j_prb_delete(tree, key) ({ \
+    tree[0].first = (key); \
+    _j_prb_delete(j_prb_header(tree), &tree[0].first); \
+})
+
+/**
+ * @brief Returns the node with the key in the version, or nil if the key is not in that version.
+ */
+#define j_prb_find(tree, version, key) ({ \
+    typeof((tree)[0].first) j_prb_needle = (key); \
+    _j_prb_find(j_prb_header(tree), (version).root, &j_prb_needle); \
+})
+
+#define j_prb_read_begin(tree) (_j_prb_read_begin(j_prb_header(tree)))
+#define j_prb_read_end(tree, version) (_j_prb_read_end(j_prb_header(tree), version))
+#define j_prb_compact(tree) (_j_prb_compact(j_prb_header(tree)))
+
+void _j_prb_init_header(PRBTreeHeader *header, Arena *arena, Arena *other_arena, u32 key_size, u32 value_size, i32 (* _Nonnull compare_func)(const void *lhs, const void *rhs));
+bool _j_prb_put(PRBTreeHeader *header, const void *key, const void *value);
+bool _j_prb_delete(PRBTreeHeader *header, const void *key);
+j_maybe(PRBNodePtr) _j_prb_find(PRBTreeHeader *header, PRBNode * _Nullable root, const void *key);
+/**
+ * @brief Pins the current version for a reader. Nodes reachable from it are not reclaimed until j_prb_read_end.
+ */
+PRBVersion _j_prb_read_begin(PRBTreeHeader *header);
+void _j_prb_read_end(PRBTreeHeader *header, PRBVersion version);
+/**
+ * @brief Copies the current version into the other arena and resets the arena holding the old versions once
+ * no reader is using them. Must only be called by the writer.
+ */
+void _j_prb_compact(PRBTreeHeader *header);
+
+// MARK: - Concurrent Skip List
+
+#define J_SL_MAX_LEVEL 16
+#define J_SL_MAX_THREADS 64
+#define EMPTY_SL NULL
+
+/**
+ * @brief A node in the skip list. The low bit of a next pointer marks the node as logically deleted on that level.
+ * The key is stored directly after the next pointers.
+ */
+typedef struct SkipNode {
+    _Atomic u64 value;
+    // Starts at 2. Dropped once when the insert has linked every level and once when the node is deleted.
+    // Whoever drops it to 0 unlinks and retires the node.
+    _Atomic u32 pending;
+    u32 height;
+    struct SkipNode * _Nullable retired_next;
+    _Atomic uintptr_t next[];
+} SkipNode;
+
+typedef SkipNode * SkipNodePtr;
+_j_stamp_maybe(SkipNodePtr);
+
+typedef struct SkipListHeader {
+    SkipNode * _Nonnull head;
+    _Atomic u64 len;
+    _Atomic u64 epoch;
+    _Atomic u32 thread_count;
+    // (epoch << 1) | 1 while the thread is inside j_sl_enter, 0 otherwise.
+    _Atomic u64 thread_epochs[J_SL_MAX_THREADS];
+    u32 key_size;
+    i32 (* _Nonnull compare_func)(const void *lhs, const void *rhs);
+} SkipListHeader;
+
+/**
+ * @brief The state a thread needs to use the skip list. Each thread registers once and must not share its handle.
+ * Nodes are allocated from the arena of the thread. Deleted nodes wait in limbo for two epochs and are then
+ * reused by the inserts of the thread that retired them.
+ */
+typedef struct SkipListThread {
+    SkipListHeader * _Nonnull list;
+    Arena * _Nonnull arena;
+    u32 id;
+    u32 nesting;
+    u64 random_state;
+    SkipNode * _Nullable limbo[3];
+    u64 limbo_epoch[3];
+    SkipNode * _Nullable free_nodes[J_SL_MAX_LEVEL + 1];
+} SkipListThread;
+
+/**
+ * @brief A lock free ordered map (Herlihy & Shavit's lock free skip list) that any number of threads can read and
+ * write concurrently. The values must be at most 8 bytes, so that an update is a single atomic store.
+ */
+#define j_sl(key, value) j_pair(key, value) * _Nullable
+#define j_sl_header(list) (cast(SkipListHeader *, list)-1)
+#define j_sl_len(list) ((list) ? atomic_load(&j_sl_header(list)->len) : 0)
+#define _j_sl_node_key(node) (cast(void *, &(node)->next[(node)->height]))
+#define j_sl_key(list, node) (*cast(typeof((list)[0].first) *, _j_sl_node_key(node)))
+#define j_sl_value(list, node) ({ \
+    u64 j_sl_bits = atomic_load(&(node)->value); \
+    typeof((list)[0].second) j_sl_out; \
+    memcpy(&j_sl_out, &j_sl_bits, sizeof(j_sl_out)); \
+    j_sl_out; \
+})
+
+/**
+ * @brief Creates the skip list. Must be called before any thread registers.
+ */
+#define j_sl_init(list, compare_function) ({ \
+    static_assert(sizeof((list)[0].second) <= sizeof(u64), "The values of a skip list must fit in 8 bytes"); \
+    if ((list) == EMPTY_SL) { \
+        (list) = malloc(sizeof(SkipListHeader) + sizeof(list[0])) + sizeof(SkipListHeader); \
+        _j_sl_init_header(j_sl_header(list), sizeof(list[0].first), compare_function); \
+    } \
+})
+
+#define j_sl_register(list, arena) (_j_sl_register(j_sl_header(list), arena))
+
+/**
+ * @brief Inserts or updates the key.
+ * @return true if the key was inserted, false if an existing value was updated.
+ */
+#define j_sl_put(list, thread, key, val) ({ \
+    typeof((list)[0].first) j_sl_k = (key); \
+    typeof((list)[0].second) j_sl_v = (val); \
+    u64 j_sl_bits = 0; \
+    memcpy(&j_sl_bits, &j_sl_v, sizeof(j_sl_v)); \
+    _j_sl_put(thread, &j_sl_k, j_sl_bits); \
+})
+
+/**
+ * @return false if the key was not in the list.
+ */
+#define j_sl_delete(list, thread, key) ({ \
+    typeof((list)[0].first) j_sl_k = (key); \
+    _j_sl_delete(thread, &j_sl_k); \
+})
+
+/**
+ * @brief Returns the node with the key, or nil. The node may only be used until j_sl_leave.
+ * Precondition: The thread must be inside j_sl_enter.
+ */
+#define j_sl_find(list, thread, key) ({ \
+    typeof((list)[0].first) j_sl_k = (key); \
+    _j_sl_find_node(thread, &j_sl_k, true); \
+})
+
+/**
+ * @brief Returns the first node whose key is not less than the key, or nil. Together with j_sl_iter_next it scans a range in order.
+ * Precondition: The thread must be inside j_sl_enter.
+ */
+#define j_sl_lower_bound(list, thread, key) ({ \
+    typeof((list)[0].first) j_sl_k = (key); \
+    _j_sl_find_node(thread, &j_sl_k, false); \
+})
+
+#define j_sl_iter(list) (_j_sl_next_live(j_sl_header(list)->head))
+#define j_sl_iter_next(list, it) (_j_sl_next_live((it).value))
+
+void _j_sl_init_header(SkipListHeader *header, u32 key_size, i32 (* _Nonnull compare_func)(const void *lhs, const void *rhs));
+SkipListThread _j_sl_register(SkipListHeader *header, Arena *arena);
+/**
+ * @brief Marks the start of a read. Nodes seen between j_sl_enter and j_sl_leave are not reused in the meantime.
+ * The calls may be nested.
+ */
+void j_sl_enter(SkipListThread *thread);
+void j_sl_leave(SkipListThread *thread);
+bool _j_sl_put(SkipListThread *thread, const void *key, u64 value);
+bool _j_sl_delete(SkipListThread *thread, const void *key);
+j_maybe(SkipNodePtr) _j_sl_find_node(SkipListThread *thread, const void *key, bool exact);
+j_maybe(SkipNodePtr) _j_sl_next_live(SkipNode *node);
+
+#define EMPTY_ARRAY NULL
+// MARK: - ArrayList New
+//#define j_list(type) J_LIST(type)
+
+typedef struct ArrHeader {
+    u64 len;
+    u64 cap;
+} ArrHeader;
+
+#define j_al_header(list) ((list) ? cast(ArrHeader *, list) - 1 : EMPTY_ARRAY)
+#define j_al_len(list) ((list) ? j_al_header(list)->len : 0)
+#define j_al_cap(list) ((list) ? j_al_header(list)->cap : 0)
+#define _j_al_init(list, arena) ({\
+    if ((list) == EMPTY_ARRAY) {  \
+        (list) = j_alloc(arena, sizeof(list[0]) * 10 + sizeof(ArrHeader)) + sizeof(ArrHeader); \
+        j_al_header(list)->len = 0;                                                                   \
+        j_al_header(list)->cap = 10;                                                                  \
+    }                             \
+})
+#define _j_al_set_cap(list, arena, new_cap) ({ \
+    u64 j_al_set_cap = (new_cap); \
+    u64 size = j_al_len(list);    \
+    typeof(list) ptr = j_alloc(arena, sizeof(list[0]) * j_al_set_cap + sizeof(ArrHeader)) + sizeof(ArrHeader); \
+    memcpy(ptr, list, sizeof(list[0]) * size);\
+    j_free(arena, j_al_header(list), sizeof(list[0]) * j_al_cap(list) + sizeof(ArrHeader));     \
+    list = ptr;                   \
+    j_al_header(list)->cap = j_al_set_cap;   \
+    j_al_header(list)->len = size;\
+})
+#define _j_al_realloc(list, arena) ({ \
+    if (j_al_len(list) == j_al_cap(list)) { \
+        _j_al_set_cap(list, arena, j_al_cap(list)*2); \
+    }                                 \
+})
+/**
+ * @brief Makes room for at least capacity elements in total, so the following appends do not reallocate.
+ */
+#define j_al_reserve(list, arena, capacity) ({ \
+    u64 j_al_wanted = (capacity); \
+    if ((list) == EMPTY_ARRAY) { \
+        u64 j_al_new_cap = j_al_wanted > 10 ? j_al_wanted : 10; \
+        (list) = j_alloc(arena, sizeof(list[0]) * j_al_new_cap + sizeof(ArrHeader)) + sizeof(ArrHeader); \
+        j_al_header(list)->len = 0; \
+        j_al_header(list)->cap = j_al_new_cap; \
+    } else if (j_al_wanted > j_al_cap(list)) { \
+        _j_al_set_cap(list, arena, j_al_wanted); \
+    } \
+})
+/**
+ * @brief Grows the capacity to at least len + n, at least doubling it, so repeated bulk appends stay amortised O(1).
+ */
+#define _j_al_reserve_more(list, arena, n) ({ \
+    u64 j_al_needed = j_al_len(list) + (n); \
+    if (j_al_needed > j_al_cap(list)) { \
+        u64 j_al_doubled = j_al_cap(list) * 2; \
+        j_al_reserve(list, arena, j_al_needed > j_al_doubled ? j_al_needed : j_al_doubled); \
+    } \
+})
+#define j_al_append(list, arena, elem) ({ \
+    _j_al_init(list, arena);              \
+    _j_al_realloc(list, arena);           \
+    list[j_al_len(list)] = (elem);        \
+    j_al_header(list)->len += 1;          \
+})
+/**
+ * @brief Appends n elements from the buffer with a single copy.
+ * Precondition: The buffer must not point into the list itself.
+ */
+#define j_al_append_n(list, arena, elems, n) ({ \
+    u64 j_al_count = (n); \
+    _j_al_reserve_more(list, arena, j_al_count); \
+    if (j_al_count > 0) { \
+        memcpy((list) + j_al_len(list), (elems), sizeof(list[0]) * j_al_count); \
+        j_al_header(list)->len += j_al_count; \
+    } \
+})
+/**
+ * @brief Appends all the elements of other to the list. The list may be extended with itself.
+ */
+#define j_al_extend(list, arena, other) ({ \
+    typeof(list) j_al_other = (other); \
+    u64 j_al_count = j_al_len(j_al_other); \
+    bool j_al_is_self = j_al_other == (list); \
+    _j_al_reserve_more(list, arena, j_al_count); \
+    if (j_al_count > 0) { \
+        memcpy((list) + j_al_len(list), j_al_is_self ? (list) : j_al_other, sizeof(list[0]) * j_al_count); \
+        j_al_header(list)->len += j_al_count; \
+    } \
+})
+/**
+ * @brief Sets the length of the list. New elements are zero initialized, shrinking keeps the capacity.
+ */
+#define j_al_resize(list, arena, new_len) ({ \
+    u64 j_al_target = (new_len); \
+    j_al_reserve(list, arena, j_al_target); \
+    if (j_al_target > j_al_len(list)) { \
+        memset((list) + j_al_len(list), 0, sizeof(list[0]) * (j_al_target - j_al_len(list))); \
+    } \
+    j_al_header(list)->len = j_al_target; \
+})
+#define j_al_swap(list, i, j) do \
+{                               \
+    typeof(list[i]) temp = list[i]; \
+    list[i] = list[j];            \
+    list[j] = temp;               \
+} while(0)
+#define j_al_removeLast(list) (j_al_header(list)->len -= 1, list[j_al_len(list)])
+#define j_al_removeFirst(list) (memmove(list, list+1, sizeof(list[0]) * (j_al_len(list)-1)), j_al_header(list)->len -= 1)
+#define j_al_last(list) ((list)[j_al_len(list)-1])
+
+// MARK: - Sorting
+
+/**
+ * The `less` parameter of the sort and search macros is an expression over the two element values
+ * `j_al_lhs` and `j_al_rhs` that is true when j_al_lhs must be ordered before j_al_rhs, e.g. `j_al_lhs.key < j_al_rhs.key`.
+ * The expression is expanded inline, so there is no function pointer call per comparison like with qsort.
+ */
+#define _j_sort_less(x, y, less) ({ \
+    typeof(x) j_al_lhs = (x); \
+    typeof(y) j_al_rhs = (y); \
+    (void)j_al_lhs; (void)j_al_rhs; \
+    (less); \
+})
+#define _j_sort_swap(x, y) do { \
+    typeof(x) j_sort_temp = (x); \
+    (x) = (y); \
+    (y) = j_sort_temp; \
+} while(0)
+#define J_SORT_INSERTION_THRESHOLD 16
+/**
+ * @brief Heapsorts the range [lo, hi), used by the introsort when the recursion depth limit is hit.
+ */
+#define _j_sort_heap(array, lo, hi, less) ({ \
+    typeof(&(array)[0]) j_heap_base = (array) + (lo); \
+    u64 j_heap_n = (hi) - (lo); \
+    for (u64 j_heap_end = j_heap_n, j_heap_start = j_heap_n / 2; j_heap_end > 1;) { \
+        u64 j_heap_root; \
+        if (j_heap_start > 0) { \
+            j_heap_root = --j_heap_start; \
+        } else { \
+            j_heap_end--; \
+            _j_sort_swap(j_heap_base[0], j_heap_base[j_heap_end]); \
+            j_heap_root = 0; \
+        } \
+        for (u64 j_heap_child; (j_heap_child = 2 * j_heap_root + 1) < j_heap_end; j_heap_root = j_heap_child) { \
+            if (j_heap_child + 1 < j_heap_end && _j_sort_less(j_heap_base[j_heap_child], j_heap_base[j_heap_child + 1], less)) { \
+                j_heap_child++; \
+            } \
+            if (!_j_sort_less(j_heap_base[j_heap_root], j_heap_base[j_heap_child], less)) break; \
+            _j_sort_swap(j_heap_base[j_heap_root], j_heap_base[j_heap_child]); \
+        } \
+    } \
+})
+/**
+ * @brief Unstable introsort of n elements of a raw array: median of three quicksort, falling back to heapsort
+ * after 2*log2(n) bad partitions, with a final insertion sort pass over the short unsorted runs.
+ */
+#define j_sort(array, n, less) ({ \
+    typeof(&(array)[0]) j_sort_a = (array); \
+    u64 j_sort_n = (n); \
+    struct { u64 lo; u64 hi; u32 depth; } j_sort_stack[64]; \
+    u32 j_sort_top = 0; \
+    if (j_sort_n > J_SORT_INSERTION_THRESHOLD) { \
+        j_sort_stack[j_sort_top++] = (typeof(j_sort_stack[0])) { 0, j_sort_n, 2 * (63 - __builtin_clzll(j_sort_n)) }; \
+    } \
+    while (j_sort_top > 0) { \
+        typeof(j_sort_stack[0]) j_sort_range = j_sort_stack[--j_sort_top]; \
+        while (j_sort_range.hi - j_sort_range.lo > J_SORT_INSERTION_THRESHOLD) { \
+            if (j_sort_range.depth == 0) { \
+                _j_sort_heap(j_sort_a, j_sort_range.lo, j_sort_range.hi, less); \
+                break; \
+            } \
+            j_sort_range.depth--; \
+            u64 j_sort_lo = j_sort_range.lo, j_sort_hi = j_sort_range.hi - 1; \
+            u64 j_sort_mid = j_sort_lo + (j_sort_hi - j_sort_lo) / 2; \
+            if (_j_sort_less(j_sort_a[j_sort_mid], j_sort_a[j_sort_lo], less)) _j_sort_swap(j_sort_a[j_sort_mid], j_sort_a[j_sort_lo]); \
+            if (_j_sort_less(j_sort_a[j_sort_hi], j_sort_a[j_sort_mid], less)) { \
+                _j_sort_swap(j_sort_a[j_sort_hi], j_sort_a[j_sort_mid]); \
+                if (_j_sort_less(j_sort_a[j_sort_mid], j_sort_a[j_sort_lo], less)) _j_sort_swap(j_sort_a[j_sort_mid], j_sort_a[j_sort_lo]); \
+            } \
+            typeof(j_sort_a[0]) j_sort_pivot = j_sort_a[j_sort_mid]; \
+            u64 j_sort_i = j_sort_lo - 1, j_sort_j = j_sort_hi + 1; \
+            while (true) { \
+                do { j_sort_i++; } while (_j_sort_less(j_sort_a[j_sort_i], j_sort_pivot, less)); \
+                do { j_sort_j--; } while (_j_sort_less(j_sort_pivot, j_sort_a[j_sort_j], less)); \
+                if (j_sort_i >= j_sort_j) break; \
+                _j_sort_swap(j_sort_a[j_sort_i], j_sort_a[j_sort_j]); \
+            } \
+            /* Continue with the smaller half so the stack stays within log2(n) entries. */ \
+            if (j_sort_j + 1 - j_sort_range.lo < j_sort_range.hi - (j_sort_j + 1)) { \
+                j_sort_stack[j_sort_top++] = (typeof(j_sort_stack[0])) { j_sort_j + 1, j_sort_range.hi, j_sort_range.depth }; \
+                j_sort_range.hi = j_sort_j + 1; \
+            } else { \
+                j_sort_stack[j_sort_top++] = (typeof(j_sort_stack[0])) { j_sort_range.lo, j_sort_j + 1, j_sort_range.depth }; \
+                j_sort_range.lo = j_sort_j + 1; \
+            } \
+        } \
+    } \
+    for (u64 j_sort_i = 1; j_sort_i < j_sort_n; j_sort_i++) { \
+        typeof(j_sort_a[0]) j_sort_elem = j_sort_a[j_sort_i]; \
+        u64 j_sort_j = j_sort_i; \
+        while (j_sort_j > 0 && _j_sort_less(j_sort_elem, j_sort_a[j_sort_j - 1], less)) { \
+            j_sort_a[j_sort_j] = j_sort_a[j_sort_j - 1]; \
+            j_sort_j--; \
+        } \
+        j_sort_a[j_sort_j] = j_sort_elem; \
+    } \
+})
+#define j_al_sort(list, less) j_sort(list, j_al_len(list), less)
+
+typedef enum J_RADIX_KEY {
+    J_RADIX_UNSIGNED,
+    J_RADIX_SIGNED,
+    J_RADIX_FLOAT,
+} J_RADIX_KEY;
+
+// The fixed width types are typedefs of these, and which one i64 names differs between platforms, so only the
+// standard types are listed. There is no default: a struct or pointer element is a compile error.
+#define _j_radix_key_kind(elem) _Generic((elem), \
+    float: J_RADIX_FLOAT, double: J_RADIX_FLOAT, \
+    char: ((char)-1 < 0 ? J_RADIX_SIGNED : J_RADIX_UNSIGNED), \
+    signed char: J_RADIX_SIGNED, short: J_RADIX_SIGNED, int: J_RADIX_SIGNED, \
+    long: J_RADIX_SIGNED, long long: J_RADIX_SIGNED, \
+    unsigned char: J_RADIX_UNSIGNED, unsigned short: J_RADIX_UNSIGNED, unsigned int: J_RADIX_UNSIGNED, \
+    unsigned long: J_RADIX_UNSIGNED, unsigned long long: J_RADIX_UNSIGNED)
+/**
+ * @brief LSD radix sort for lists of integers or floats, one byte per pass. Uses a scratch buffer from the arena.
+ * Floats are ordered by their IEEE total order, so -0.0 sorts before 0.0 and NaNs go to the ends.
+ */
+#define j_al_radix_sort(list, arena) ({ \
+    static_assert(sizeof(list[0]) == 1 || sizeof(list[0]) == 2 || sizeof(list[0]) == 4 || sizeof(list[0]) == 8, "Radix sort only supports integer and float elements"); \
+    j_radix_sort(list, j_al_len(list), sizeof(list[0]), _j_radix_key_kind(list[0]), arena); \
+})
+void j_radix_sort(void * _Nullable data, u64 n, u32 elem_size, J_RADIX_KEY kind, Arena * _Nonnull arena);
+
+/**
+ * @brief Index of the first element that is not ordered before elem, or the length if there is none.
+ * Precondition: The list must be sorted by the same less expression.
+ */
+#define j_al_lower_bound(list, elem, less) ({ \
+    typeof(list[0]) j_al_value = (elem); \
+    u64 j_al_first = 0, j_al_count = j_al_len(list); \
+    while (j_al_count > 0) { \
+        u64 j_al_step = j_al_count / 2; \
+        if (_j_sort_less((list)[j_al_first + j_al_step], j_al_value, less)) { \
+            j_al_first += j_al_step + 1; \
+            j_al_count -= j_al_step + 1; \
+        } else { \
+            j_al_count = j_al_step; \
+        } \
+    } \
+    j_al_first; \
+})
+/**
+ * @brief Returns the index of an element equivalent to elem.
+ * Precondition: The list must be sorted by the same less expression.
+ */
+#define j_al_binary_search(list, elem, less) ({ \
+    typeof(list[0]) j_al_needle = (elem); \
+    u64 j_al_index = j_al_lower_bound(list, j_al_needle, less); \
+    j_maybe(u64) j_al_result = NIL; \
+    if (j_al_index < j_al_len(list) && !_j_sort_less(j_al_needle, (list)[j_al_index], less)) { \
+        j_al_result = (j_maybe(u64)) { .is_present = true, .value = j_al_index }; \
+    } \
+    j_al_result; \
+})
+/**
+ * @brief Reorders the list so the elements that satisfy the predicate come first, and returns how many there are.
+ * The predicate is an expression over `j_al_it`, the order within each group is not preserved.
+ */
+#define j_al_partition(list, pred) ({ \
+    u64 j_al_split = 0; \
+    for (u64 j_al_i = 0; j_al_i < j_al_len(list); j_al_i++) { \
+        typeof(list[0]) j_al_it = (list)[j_al_i]; \
+        if (pred) { \
+            _j_sort_swap((list)[j_al_split], (list)[j_al_i]); \
+            j_al_split++; \
+        } \
+    } \
+    j_al_split; \
+})
+
+// MARK: - Heap
+
+/**
+ * @brief A binary heap stored in an ArrayList, so it shares the ArrHeader prefix and every j_al macro works on it.
+ * The `less` parameter follows j_sort: the top is an element that no other element is ordered before, so
+ * `j_al_lhs < j_al_rhs` gives a min heap. The j_heap4 variants use four children per node, which halves the depth and
+ * keeps the children of a node in one cache line; use the same arity for every operation on a heap.
+ */
+#define j_heap(type) J_LIST(type)
+#define EMPTY_HEAP EMPTY_ARRAY
+#define j_heap_len(heap) j_al_len(heap)
+/**
+ * @brief The top element.
+ * Precondition: The heap must not be empty.
+ */
+#define j_heap_peek(heap) ((heap)[0])
+
+#define _j_heap_sift_up(heap, start, less, arity) ({ \
+    u64 j_heap_i = (start); \
+    typeof(heap[0]) j_heap_elem = (heap)[j_heap_i]; \
+    while (j_heap_i > 0) { \
+        u64 j_heap_parent = (j_heap_i - 1) / (arity); \
+        if (!_j_sort_less(j_heap_elem, (heap)[j_heap_parent], less)) break; \
+        (heap)[j_heap_i] = (heap)[j_heap_parent]; \
+        j_heap_i = j_heap_parent; \
+    } \
+    (heap)[j_heap_i] = j_heap_elem; \
+})
+#define _j_heap_sift_down(heap, len, start, less, arity) ({ \
+    u64 j_heap_n = (len), j_heap_i = (start); \
+    typeof(heap[0]) j_heap_elem = (heap)[j_heap_i]; \
+    while (true) { \
+        u64 j_heap_first = j_heap_i * (arity) + 1; \
+        if (j_heap_first >= j_heap_n) break; \
+        u64 j_heap_end = j_heap_first + (arity) < j_heap_n ? j_heap_first + (arity) : j_heap_n; \
+        u64 j_heap_best = j_heap_first; \
+        for (u64 j_heap_c = j_heap_first + 1; j_heap_c < j_heap_end; ++j_heap_c) { \
+            if (_j_sort_less((heap)[j_heap_c], (heap)[j_heap_best], less)) j_heap_best = j_heap_c; \
+        } \
+        if (!_j_sort_less((heap)[j_heap_best], j_heap_elem, less)) break; \
+        (heap)[j_heap_i] = (heap)[j_heap_best]; \
+        j_heap_i = j_heap_best; \
+    } \
+    (heap)[j_heap_i] = j_heap_elem; \
+})
+#define _j_heap_push(heap, arena, elem, less, arity) ({ \
+    j_al_append(heap, arena, elem); \
+    _j_heap_sift_up(heap, j_al_len(heap) - 1, less, arity); \
+})
+#define _j_heap_pop(heap, less, arity) ({ \
+    jassert(j_al_len(heap) > 0, "Precondition: Cannot pop from an empty heap.\n"); \
+    typeof(heap[0]) j_heap_top = (heap)[0]; \
+    j_al_header(heap)->len -= 1; \
+    if (j_al_len(heap) > 0) { \
+        (heap)[0] = (heap)[j_al_len(heap)]; \
+        _j_heap_sift_down(heap, j_al_len(heap), 0, less, arity); \
+    } \
+    j_heap_top; \
+})
+/**
+ * @brief Replaces the top with elem and restores the heap, cheaper than a pop followed by a push.
+ */
+#define _j_heap_replace_top(heap, elem, less, arity) ({ \
+    (heap)[0] = (elem); \
+    _j_heap_sift_down(heap, j_al_len(heap), 0, less, arity); \
+})
+#define _j_heapify(list, less, arity) ({ \
+    u64 j_heapify_n = j_al_len(list); \
+    if (j_heapify_n > 1) { \
+        /* Sift down every parent, starting from the last one. */ \
+        for (u64 j_heapify_i = (j_heapify_n - 2) / (arity) + 1; j_heapify_i-- > 0;) { \
+            _j_heap_sift_down(list, j_heapify_n, j_heapify_i, less, arity); \
+        } \
+    } \
+})
+
+#define j_heap_push(heap, arena, elem, less) _j_heap_push(heap, arena, elem, less, 2)
+#define j_heap_pop(heap, less) _j_heap_pop(heap, less, 2)
+#define j_heap_replace_top(heap, elem, less) _j_heap_replace_top(heap, elem, less, 2)
+/**
+ * @brief Turns an existing ArrayList into a heap in place in O(n).
+ */
+#define j_heapify(list, less) _j_heapify(list, less, 2)
+#define j_heap4_push(heap, arena, elem, less) _j_heap_push(heap, arena, elem, less, 4)
+#define j_heap4_pop(heap, less) _j_heap_pop(heap, less, 4)
+#define j_heap4_replace_top(heap, elem, less) _j_heap_replace_top(heap, elem, less, 4)
+#define j_heap4_heapify(list, less) _j_heapify(list, less, 4)
+
+/**
+ * @brief Returns a new list with the k elements of the list that are ordered last by less, e.g. the k largest for
+ * `j_al_lhs < j_al_rhs`. Runs in O(n log k) with a bounded min heap, the result is in heap order.
+ */
+#define j_al_top_k(list, arena, k, less) ({ \
+    u64 j_top_k = (k); \
+    j_heap(typeof((list)[0])) j_top_heap = EMPTY_HEAP; \
+    if (j_top_k > 0) { \
+        j_al_reserve(j_top_heap, arena, j_top_k); \
+        for (u64 j_top_i = 0; j_top_i < j_al_len(list); ++j_top_i) { \
+            if (j_al_len(j_top_heap) < j_top_k) { \
+                _j_heap_push(j_top_heap, arena, (list)[j_top_i], less, 4); \
+            } else if (_j_sort_less(j_heap_peek(j_top_heap), (list)[j_top_i], less)) { \
+                _j_heap_replace_top(j_top_heap, (list)[j_top_i], less, 4); \
+            } \
+        } \
+    } \
+    j_top_heap; \
+})
+
+// MARK: - Mapped ArrayList
+
+/**
+ * @brief Flags for j_al_map. A read only mapping has cap == len and must not be written to. J_MAP_CREATE creates
+ * the file when it is missing and truncates nothing.
+ */
+enum J_MAP_FLAGS {
+    J_MAP_READ_ONLY = 0,
+    J_MAP_WRITABLE = 1 << 0,
+    J_MAP_CREATE = 1 << 1,
 };
 
-typedef struct Path {
-    Str  * _Nullable components;
-} Path;
+/**
+ * @brief The file holds the raw elements without any header. The header lives at the end of a private page mapped
+ * just in front of the file, so j_al_len, j_al_cap and indexing work on the view like on any other list.
+ */
+typedef struct MappedListHeader {
+    i32 fd;
+    u32 flags;
+    u64 elem_size;
+    u64 reserved;
+    ArrHeader list;
+} MappedListHeader;
+
+#define j_al_mapped_header(list) (cast(MappedListHeader *, j_al_header(list) + 1) - 1)
+/**
+ * @brief Opens the file at path as a list of type. The pages are loaded lazily by the OS on first access.
+ * Returns NULL if the file cannot be opened or mapped.
+ */
+#define j_al_map(type, path, flags) cast(j_list(type), _j_al_map_file(path, sizeof(type), flags))
+/**
+ * @brief Grows the file so it can hold at least capacity elements and remaps it. The list may move.
+ * Precondition: The list must be mapped with J_MAP_WRITABLE.
+ */
+#define j_al_mapped_reserve(list, capacity) ({ \
+    void *j_al_mapped = (list); \
+    bool j_al_ok = _j_al_mapped_reserve(&j_al_mapped, (capacity)); \
+    (list) = j_al_mapped; \
+    j_al_ok; \
+})
+/**
+ * @brief Appends to a writable mapped list, doubling the file when it is full. Do not use j_al_append on a mapped list.
+ */
+#define j_al_mapped_append(list, elem) ({ \
+    if (j_al_len(list) == j_al_cap(list)) { \
+        u64 j_al_doubled = j_al_cap(list) * 2; \
+        bool j_al_grown = j_al_mapped_reserve(list, j_al_doubled > 64 ? j_al_doubled : 64); \
+        jassert(j_al_grown, "Could not grow the mapped file\n"); \
+        (void)j_al_grown; \
+    } \
+    (list)[j_al_len(list)] = (elem); \
+    j_al_header(list)->len += 1; \
+})
+/**
+ * @brief Makes the list durable: the elements are flushed and a writable file is truncated to the length of the
+ * list, so after a sync the file holds exactly the list. The spare capacity is given up, and the next append
+ * grows the file again. Returns false if flushing or truncating failed.
+ * Crash contract: elements appended after the last sync are not durable. A crash before the next sync can leave
+ * the file at its reserved size, with the unsynced elements followed by zero filled slack, so a reader that must
+ * tell them apart has to store its own length or a sentinel.
+ */
+#define j_al_mapped_sync(list) _j_al_mapped_sync(list)
+/**
+ * @brief Unmaps the list and closes the file. A writable file is truncated to the length of the list.
+ * Returns false if the truncation failed, in which case the file keeps its reserved size.
+ */
+#define j_al_unmap(list) _j_al_unmap(list)
+
+void * _Nullable _j_al_map_file(const char * _Nonnull path, u64 elem_size, u32 flags);
+bool _j_al_mapped_reserve(void * _Nonnull * _Nonnull list, u64 capacity);
+bool _j_al_mapped_sync(void * _Nonnull list);
+bool _j_al_unmap(void * _Nonnull list);
+
+// MARK: - Deque
+
+/**
+ * @brief Ring buffer with the same header prefix layout as the ArrayList, use it instead of j_al_removeFirst for queues.
+ * The capacity is always a power of two so the logical index wraps with a mask.
+ */
+#define j_deque(type) type * _Nullable
+#define EMPTY_DEQUE NULL
+#define J_DEQUE_INITIAL_CAP 16
+
+typedef struct DequeHeader {
+    u64 head;
+    u64 len;
+    u64 cap;
+} DequeHeader;
+
+#define j_dq_header(dq) ((dq) ? cast(DequeHeader *, dq) - 1 : EMPTY_DEQUE)
+#define j_dq_len(dq) ((dq) ? j_dq_header(dq)->len : 0)
+#define j_dq_cap(dq) ((dq) ? j_dq_header(dq)->cap : 0)
+#define _j_dq_slot(dq, i) ((j_dq_header(dq)->head + (i)) & (j_dq_header(dq)->cap - 1))
+/**
+ * @brief Element at the logical index i, counted from the front. Usable as an lvalue.
+ */
+#define j_dq_at(dq, i) ((dq)[_j_dq_slot(dq, i)])
+#define j_dq_front(dq) j_dq_at(dq, 0)
+#define j_dq_back(dq) j_dq_at(dq, j_dq_len(dq) - 1)
+/**
+ * @brief Doubles the capacity when the deque is full, unwrapping the elements to the start of the new buffer.
+ */
+#define _j_dq_grow(dq, arena) ({ \
+    if ((dq) == EMPTY_DEQUE) { \
+        (dq) = j_alloc(arena, sizeof(dq[0]) * J_DEQUE_INITIAL_CAP + sizeof(DequeHeader)) + sizeof(DequeHeader); \
+        j_dq_header(dq)->head = 0; \
+        j_dq_header(dq)->len = 0; \
+        j_dq_header(dq)->cap = J_DEQUE_INITIAL_CAP; \
+    } else if (j_dq_len(dq) == j_dq_cap(dq)) { \
+        u64 j_dq_old_cap = j_dq_cap(dq); \
+        u64 j_dq_head = j_dq_header(dq)->head; \
+        u64 j_dq_first = j_dq_old_cap - j_dq_head; \
+        typeof(dq) j_dq_ptr = j_alloc(arena, sizeof(dq[0]) * j_dq_old_cap * 2 + sizeof(DequeHeader)) + sizeof(DequeHeader); \
+        memcpy(j_dq_ptr, (dq) + j_dq_head, sizeof(dq[0]) * j_dq_first); \
+        memcpy(j_dq_ptr + j_dq_first, (dq), sizeof(dq[0]) * j_dq_head); \
+        j_free(arena, j_dq_header(dq), sizeof(dq[0]) * j_dq_old_cap + sizeof(DequeHeader)); \
+        (dq) = j_dq_ptr; \
+        j_dq_header(dq)->head = 0; \
+        j_dq_header(dq)->len = j_dq_old_cap; \
+        j_dq_header(dq)->cap = j_dq_old_cap * 2; \
+    } \
+})
+#define j_dq_push_back(dq, arena, elem) ({ \
+    _j_dq_grow(dq, arena); \
+    j_dq_at(dq, j_dq_len(dq)) = (elem); \
+    j_dq_header(dq)->len += 1; \
+})
+#define j_dq_push_front(dq, arena, elem) ({ \
+    _j_dq_grow(dq, arena); \
+    j_dq_header(dq)->head = (j_dq_header(dq)->head - 1) & (j_dq_cap(dq) - 1); \
+    j_dq_header(dq)->len += 1; \
+    j_dq_front(dq) = (elem); \
+})
+/**
+ * @brief Removes and returns the first element.
+ * Precondition: The deque must not be empty.
+ */
+#define j_dq_pop_front(dq) ({ \
+    jassert(j_dq_len(dq) > 0, "Precondition: Cannot pop from an empty deque.\n"); \
+    typeof(dq[0]) j_dq_elem = j_dq_front(dq); \
+    j_dq_header(dq)->head = (j_dq_header(dq)->head + 1) & (j_dq_cap(dq) - 1); \
+    j_dq_header(dq)->len -= 1; \
+    j_dq_elem; \
+})
+/**
+ * @brief Removes and returns the last element.
+ * Precondition: The deque must not be empty.
+ */
+#define j_dq_pop_back(dq) ({ \
+    jassert(j_dq_len(dq) > 0, "Precondition: Cannot pop from an empty deque.\n"); \
+    j_dq_header(dq)->len -= 1; \
+    j_dq_at(dq, j_dq_len(dq)); \
+})
+#define j_dq_clear(dq) ({ \
+    if ((dq) != EMPTY_DEQUE) { \
+        j_dq_header(dq)->head = 0; \
+        j_dq_header(dq)->len = 0; \
+    } \
+})
+
+// MARK: - Slot Map
+
+/**
+ * @brief A handle to an element in a slot map. It stays valid until that element is erased, after which the
+ * generation no longer matches and lookups with it fail.
+ */
+typedef struct SlotHandle {
+    u32 index;
+    u32 generation;
+} SlotHandle;
+_j_stamp_maybe(SlotHandle);
+
+/**
+ * @brief For a live slot dense is the position of its value, for a free slot it links to the next free slot.
+ */
+typedef struct SlotEntry {
+    u32 dense;
+    u32 generation;
+} SlotEntry;
+
+/**
+ * @brief The values follow the header, so it is aligned like max_align_t, which also rounds its size up to keep the
+ * values aligned.
+ */
+typedef struct SlotMapHeader {
+    _Alignas(max_align_t) u32 len;
+    u32 cap;
+    u32 slot_count;
+    u32 free_head;
+    SlotEntry * _Nullable slots;
+    u32 * _Nullable dense_to_slot;
+} SlotMapHeader;
+
+/**
+ * @brief Values live densely packed in front of the header prefix, like an ArrayList, so iterating map[0..len) is a
+ * linear scan. Handles go through the slots array, erasing moves the last value into the hole.
+ */
+#define j_slotmap(type) type * _Nullable
+#define EMPTY_SLOTMAP NULL
+#define J_SLOT_NONE UINT32_MAX
+#define j_slot_header(map) ((map) ? cast(SlotMapHeader *, map) - 1 : EMPTY_SLOTMAP)
+#define j_slot_len(map) ((map) ? j_slot_header(map)->len : 0)
+#define j_slot_cap(map) ((map) ? j_slot_header(map)->cap : 0)
+#define _j_slot_dense_index(map, handle) ({ \
+    SlotHandle j_slot_h = (handle); \
+    u32 j_slot_dense = J_SLOT_NONE; \
+    if ((map) && j_slot_h.index < j_slot_header(map)->slot_count) { \
+        SlotEntry j_slot_entry = j_slot_header(map)->slots[j_slot_h.index]; \
+        if (j_slot_entry.generation == j_slot_h.generation) j_slot_dense = j_slot_entry.dense; \
+    } \
+    j_slot_dense; \
+})
+/**
+ * @brief Stores the value and returns its handle.
+ */
+#define j_slot_insert(map, arena, value) ({ \
+    (map) = _j_slot_reserve((map), arena, sizeof(map[0])); \
+    SlotHandle j_slot_handle = _j_slot_push(j_slot_header(map)); \
+    (map)[j_slot_len(map) - 1] = (value); \
+    j_slot_handle; \
+})
+/**
+ * @brief Pointer to the value of the handle, or NULL if the handle is stale. The pointer is invalidated by the next
+ * insert or erase.
+ */
+#define j_slot_get(map, handle) ({ \
+    u32 j_slot_index = _j_slot_dense_index(map, handle); \
+    j_slot_index == J_SLOT_NONE ? NULL : &(map)[j_slot_index]; \
+})
+#define j_slot_contains(map, handle) (_j_slot_dense_index(map, handle) != J_SLOT_NONE)
+/**
+ * @brief Erases the element of the handle in O(1). Returns false if the handle is stale.
+ */
+#define j_slot_erase(map, handle) _j_slot_erase(j_slot_header(map), (map), sizeof(map[0]), (handle))
+/**
+ * @brief Handle of the value at dense position i, for use while iterating over map[0..len).
+ */
+#define j_slot_handle_at(map, i) ({ \
+    u32 j_slot_s = j_slot_header(map)->dense_to_slot[i]; \
+    (SlotHandle) { .index = j_slot_s, .generation = j_slot_header(map)->slots[j_slot_s].generation }; \
+})
+
+void * _Nonnull _j_slot_reserve(void * _Nullable map, Arena * _Nonnull arena, u64 elem_size);
+SlotHandle _j_slot_push(SlotMapHeader * _Nonnull header);
+bool _j_slot_erase(SlotMapHeader * _Nullable header, void * _Nullable values, u64 elem_size, SlotHandle handle);
+
+// MARK: - Small List
+
+/**
+ * @brief A list that keeps its first n elements inline in the owning struct and only allocates from the arena once it
+ * outgrows them. Declare it with a typedef to pass it around, e.g. `typedef j_small_list(Str, 8) SmallStrList;`.
+ * The inline elements move with the struct, so always go through j_small_list_data and j_small_list_at instead of
+ * keeping pointers.
+ */
+#define j_small_list(type, n) struct { \
+    u64 len; \
+    u64 cap; \
+    type * _Nullable spilled; \
+    type inline_elems[n]; \
+}
+#define EMPTY_SMALL_LIST { 0 }
+#define j_small_list_inline_cap(list) (sizeof((list).inline_elems) / sizeof((list).inline_elems[0]))
+#define j_small_list_len(list) ((list).len)
+#define j_small_list_cap(list) ((list).spilled ? (list).cap : j_small_list_inline_cap(list))
+#define j_small_list_is_inline(list) ((list).spilled == NULL)
+#define j_small_list_data(list) ((list).spilled ? (list).spilled : (list).inline_elems)
+#define j_small_list_at(list, i) (j_small_list_data(list)[i])
+#define j_small_list_last(list) (j_small_list_data(list)[(list).len - 1])
+#define _j_small_list_grow(list, arena) ({ \
+    if ((list).len == j_small_list_cap(list)) { \
+        u64 j_small_list_new_cap = j_small_list_cap(list) * 2; \
+        typeof(&(list).inline_elems[0]) j_small_list_ptr = j_alloc(arena, sizeof((list).inline_elems[0]) * j_small_list_new_cap); \
+        memcpy(j_small_list_ptr, j_small_list_data(list), sizeof((list).inline_elems[0]) * (list).len); \
+        if ((list).spilled) { \
+            j_free(arena, (list).spilled, sizeof((list).inline_elems[0]) * (list).cap); \
+        } \
+        (list).spilled = j_small_list_ptr; \
+        (list).cap = j_small_list_new_cap; \
+    } \
+})
+/**
+ * @brief Appends the element. The arena is only used when the inline storage is full.
+ */
+#define j_small_list_append(list, arena, elem) ({ \
+    _j_small_list_grow(list, arena); \
+    j_small_list_data(list)[(list).len] = (elem); \
+    (list).len += 1; \
+})
+#define j_small_list_remove_last(list) ((list).len -= 1, j_small_list_data(list)[(list).len])
+#define j_small_list_clear(list) ((list).len = 0)
+
+// MARK: - Thread Pool
+
+#define J_POOL_QUEUE_CAP 1024
+
+struct PoolWorker;
+/**
+ * @brief A task processes the index range [begin, end). The worker gives access to its scratch arena,
+ * everything the task allocates there is released when the task returns.
+ */
+typedef void (*PoolTaskFunc)(void * _Nullable ctx, u64 begin, u64 end, struct PoolWorker * _Nonnull worker);
+
+/**
+ * @brief Counts the unfinished tasks submitted with it, j_pool_wait returns once it reaches zero.
+ */
+typedef struct TaskGroup {
+    _Atomic u64 pending;
+} TaskGroup;
+
+typedef struct PoolTask {
+    PoolTaskFunc _Nonnull func;
+    void * _Nullable ctx;
+    u64 begin;
+    u64 end;
+    TaskGroup * _Nonnull group;
+} PoolTask;
+
+/**
+ * @brief Each worker owns a deque of tasks. The owner pushes and pops at the tail, idle workers steal from the head.
+ */
+typedef struct PoolWorker {
+    struct ThreadPool * _Nonnull pool;
+    Arena arena;
+    u32 id;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    u64 head;
+    u64 tail;
+    PoolTask tasks[J_POOL_QUEUE_CAP];
+} PoolWorker;
+
+/**
+ * @brief A work stealing thread pool. workers[worker_count] is the slot of the thread outside the pool, which
+ * helps running tasks while it waits. Only one thread outside the pool may submit and wait at a time.
+ */
+typedef struct ThreadPool {
+    u32 worker_count;
+    PoolWorker * _Nonnull workers;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    _Atomic u64 queued;
+    _Atomic bool shutdown;
+} ThreadPool;
+
+/**
+ * @brief Starts a pool with thread_count workers, or one per online core when thread_count is 0.
+ * Every worker, and the calling thread, gets a scratch arena of scratch_size bytes.
+ */
+ThreadPool * _Nonnull j_make_thread_pool(u32 thread_count, u64 scratch_size);
+void j_thread_pool_destroy(ThreadPool * _Nonnull pool);
+/**
+ * @brief Queues func over [begin, end) on the deque of the calling worker. Runs it inline if that deque is full.
+ */
+void j_pool_submit(ThreadPool * _Nonnull pool, TaskGroup * _Nonnull group, PoolTaskFunc _Nonnull func, void * _Nullable ctx, u64 begin, u64 end);
+/**
+ * @brief Runs queued tasks until every task of the group has finished.
+ */
+void j_pool_wait(ThreadPool * _Nonnull pool, TaskGroup * _Nonnull group);
+/**
+ * @brief Calls func over [0, n) split into ranges of at most grain indices, and waits for all of them.
+ * The ranges are split recursively so idle workers steal large halves. A grain of 0 picks one from n and the worker count.
+ */
+void j_parallel_for(ThreadPool * _Nonnull pool, u64 n, u64 grain, PoolTaskFunc _Nonnull func, void * _Nullable ctx);
+#define j_al_parallel_for(pool, list, func, ctx) j_parallel_for(pool, j_al_len(list), 0, func, ctx)
+
+#define J_PARALLEL_SORT_CUTOFF (1 << 15)
+/**
+ * @brief Stamps `void name(ThreadPool *pool, Arena *arena, type *array, u64 n)`, a parallel merge sort using the same
+ * `less` expression as j_sort. Chunks are sorted with j_sort and then merged pairwise, where every merge is split
+ * into equal output pieces with a merge path search, so all the workers stay busy up to the last round.
+ * The merge buffer of n elements is allocated from the arena. The sort is not stable.
+ */
+#define _j_stamp_parallel_sort(name, type, less) \
+typedef struct name##_ctx { \
+    type * _Nonnull src; \
+    type * _Nonnull dst; \
+    u64 n; \
+    u64 run; \
+    u64 piece; \
+    u64 pieces_per_pair; \
+} name##_ctx; \
+static void name##_sort_chunk(void * _Nullable ctx, u64 begin, u64 end, PoolWorker * _Nonnull worker) { \
+    (void)worker; \
+    name##_ctx *c = ctx; \
+    for (u64 chunk = begin; chunk < end; ++chunk) { \
+        u64 lo = chunk * c->run; \
+        u64 hi = lo + c->run < c->n ? lo + c->run : c->n; \
+        if (lo < hi) j_sort(c->src + lo, hi - lo, less); \
+    } \
+} \
+static u64 name##_co_rank(type * _Nonnull a, u64 na, type * _Nonnull b, u64 nb, u64 k) { \
+    u64 lo = k > nb ? k - nb : 0; \
+    u64 hi = k < na ? k : na; \
+    while (lo < hi) { \
+        u64 i = lo + (hi - lo) / 2; \
+        if (!_j_sort_less(b[k - i - 1], a[i], less)) lo = i + 1; \
+        else hi = i; \
+    } \
+    return lo; \
+} \
+static void name##_merge_pieces(void * _Nullable ctx, u64 begin, u64 end, PoolWorker * _Nonnull worker) { \
+    (void)worker; \
+    name##_ctx *c = ctx; \
+    for (u64 piece = begin; piece < end; ++piece) { \
+        u64 lo = (piece / c->pieces_per_pair) * 2 * c->run; \
+        u64 mid = lo + c->run < c->n ? lo + c->run : c->n; \
+        u64 hi = mid + c->run < c->n ? mid + c->run : c->n; \
+        u64 k0 = (piece % c->pieces_per_pair) * c->piece; \
+        if (lo + k0 >= hi) continue; \
+        u64 k1 = lo + k0 + c->piece < hi ? k0 + c->piece : hi - lo; \
+        type *a = c->src + lo; \
+        type *b = c->src + mid; \
+        u64 na = mid - lo, nb = hi - mid; \
+        u64 i = name##_co_rank(a, na, b, nb, k0), i_end = name##_co_rank(a, na, b, nb, k1); \
+        u64 j = k0 - i, j_end = k1 - i_end; \
+        type *out = c->dst + lo + k0; \
+        while (i < i_end && j < j_end) { \
+            *out++ = _j_sort_less(b[j], a[i], less) ? b[j++] : a[i++]; \
+        } \
+        while (i < i_end) *out++ = a[i++]; \
+        while (j < j_end) *out++ = b[j++]; \
+    } \
+} \
+static void name(ThreadPool * _Nonnull pool, Arena * _Nonnull arena, type * _Nullable array, u64 n) { \
+    u64 lanes = pool->worker_count + 1; \
+    if (n < J_PARALLEL_SORT_CUTOFF || lanes == 1) { \
+        j_sort(array, n, less); \
+        return; \
+    } \
+    type *scratch = j_alloc(arena, sizeof(type) * n); \
+    u64 chunks = lanes * 4; \
+    name##_ctx c = { .src = array, .dst = scratch, .n = n, .run = (n + chunks - 1) / chunks }; \
+    j_parallel_for(pool, chunks, 1, name##_sort_chunk, &c); \
+    c.piece = n / (lanes * 4) > J_PARALLEL_SORT_CUTOFF / 2 ? n / (lanes * 4) : J_PARALLEL_SORT_CUTOFF / 2; \
+    for (; c.run < n; c.run *= 2) { \
+        u64 pairs = (n + 2 * c.run - 1) / (2 * c.run); \
+        c.pieces_per_pair = (2 * c.run + c.piece - 1) / c.piece; \
+        j_parallel_for(pool, pairs * c.pieces_per_pair, 1, name##_merge_pieces, &c); \
+        type *temp = c.src; \
+        c.src = c.dst; \
+        c.dst = temp; \
+    } \
+    if (c.src != array) { \
+        memcpy(array, c.src, sizeof(type) * n); \
+    } \
+    j_free(arena, scratch, sizeof(type) * n); \
+}
+#define j_al_parallel_sort(pool, arena, list, name) name(pool, arena, list, j_al_len(list))
+
+// MARK: - Structure of Arrays
+
+/**
+ * @brief A list that stores every field of its rows in a separate column, so loops that read one field only touch
+ * that field's memory. The fields come from an X macro list, for example
+ *
+ *     #define PARTICLE_FIELDS(X) X(f32, x) X(f32, y) X(u32, id)
+ *     _j_stamp_soa(Particle, PARTICLE_FIELDS)
+ *     j_soa(Particle) particles = EMPTY_SOA;
+ *     j_soa_append(Particle, &particles, arena, ((Particle) { .x = 1, .y = 2, .id = 3 }));
+ *     f32 *xs = j_soa_column(&particles, x);
+ *
+ * The stamp defines the row struct `name` and the container `name##SoA`, whose columns share one len and cap and all
+ * live in a single arena block, each column starting on a J_SOA_ALIGN byte boundary.
+ * Every accessor takes a pointer to the container. The ones that go through the stamped functions also take `name`.
+ */
+#define j_soa(name) name##SoA
+#define EMPTY_SOA { 0 }
+#define J_SOA_ALIGN 64
+#define _j_soa_round(size) (((size) + J_SOA_ALIGN - 1) & ~cast(u64, J_SOA_ALIGN - 1))
+
+#define _J_SOA_ROW_FIELD(type, field) type field;
+#define _J_SOA_COLUMN(type, field) type * _Nullable field;
+#define _J_SOA_COLUMN_SIZE(type, field) + _j_soa_round(sizeof(type) * cap)
+#define _J_SOA_COLUMN_MOVE(type, field) { \
+    type *column = cast(type *, cursor); \
+    if (soa->len > 0) memcpy(column, soa->field, sizeof(type) * soa->len); \
+    soa->field = column; \
+    cursor += _j_soa_round(sizeof(type) * cap); \
+}
+#define _J_SOA_STORE(type, field) soa->field[index] = row.field;
+#define _J_SOA_LOAD(type, field) row.field = soa->field[index];
+
+#define _j_stamp_soa(name, FIELDS) \
+typedef struct name { \
+    FIELDS(_J_SOA_ROW_FIELD) \
+} name; \
+typedef struct name##SoA { \
+    u64 len; \
+    u64 cap; \
+    void * _Nullable block; \
+    u64 block_size; \
+    FIELDS(_J_SOA_COLUMN) \
+} name##SoA; \
+static inline void name##_soa_reserve(name##SoA * _Nonnull soa, Arena * _Nonnull arena, u64 cap) { \
+    if (cap <= soa->cap) return; \
+    u64 block_size = J_SOA_ALIGN - 1 FIELDS(_J_SOA_COLUMN_SIZE); \
+    void *block = j_alloc(arena, block_size); \
+    u8 *cursor = cast(u8 *, _j_soa_round(cast(uintptr_t, block))); \
+    FIELDS(_J_SOA_COLUMN_MOVE) \
+    if (soa->block != NULL) j_free(arena, soa->block, soa->block_size); \
+    soa->block = block; \
+    soa->block_size = block_size; \
+    soa->cap = cap; \
+} \
+static inline void name##_soa_set(name##SoA * _Nonnull soa, u64 index, name row) { \
+    jassert(index < soa->len, "Precondition: The index must be less than the length\n"); \
+    FIELDS(_J_SOA_STORE) \
+} \
+static inline name name##_soa_get(name##SoA * _Nonnull soa, u64 index) { \
+    jassert(index < soa->len, "Precondition: The index must be less than the length\n"); \
+    name row; \
+    FIELDS(_J_SOA_LOAD) \
+    return row; \
+} \
+static inline void name##_soa_append(name##SoA * _Nonnull soa, Arena * _Nonnull arena, name row) { \
+    if (soa->len == soa->cap) name##_soa_reserve(soa, arena, soa->cap ? soa->cap * 2 : 16); \
+    u64 index = soa->len++; \
+    FIELDS(_J_SOA_STORE) \
+}
+
+#define j_soa_len(soa) ((soa)->len)
+#define j_soa_cap(soa) ((soa)->cap)
+#define j_soa_reserve(name, soa, arena, cap) name##_soa_reserve(soa, arena, cap)
+#define j_soa_append(name, soa, arena, row) name##_soa_append(soa, arena, row)
+#define j_soa_get(name, soa, index) name##_soa_get(soa, index)
+#define j_soa_set(name, soa, index, row) name##_soa_set(soa, index, row)
+/**
+ * @brief Pointer to the column of field, marked as J_SOA_ALIGN aligned so loops over it vectorise without peeling.
+ */
+#define j_soa_column(soa, field) cast(typeof((soa)->field), __builtin_assume_aligned((soa)->field, J_SOA_ALIGN))
+/**
+ * @brief Element of a single field, usable as an lvalue.
+ */
+#define j_soa_at(soa, field, index) ((soa)->field[index])
+
+
+
+
+
+/**
+ * @brief Skips the elements from the substring that satisfies the predicate
+ */
+#define j_ss_remove_while(ss, pred) do { \
+    char j_ss_it;                                   \
+    while ((ss)->str.len > 0 && (j_ss_it = *(ss)->str.str, (pred))) { \
+        j_ss_remove_first(ss);                                  \
+    }\
+} while(0)
+
+
+/**
+ * @brief returns the first index where the predicate is true
+ */
+#define j_ss_first_index_where(ss, pred) ({ \
+    Str j_ss_it = (ss).str; \
+    u32 j_ss_index = 0; \
+    while (j_ss_index < (ss).str.len && !(pred)) { \
+        j_ss_index++;                       \
+        j_ss_it.str++;                      \
+        j_ss_it.len--;                      \
+    } \
+    j_ss_index; \
+})
+
+/**
+ * @brief Returns a substring from the start of the substring up until the predicate returns false.
+ */
+#define j_ss_prefix_while(ss, pred) ({ \
+    SubStr temp = (ss);                \
+    temp.str.len = 0;                  \
+    char j_ss_it;                      \
+    while (temp.str.len < (ss).str.len && (j_ss_it = temp.str.str[temp.str.len], (pred))) { \
+        temp.str.len++;                \
+    }                                  \
+    temp;                              \
+})
+
+/**
+ * @brief resets the SubString to the original String
+ */
+#define j_ss_reset(ss) (ss).str = *(ss).base
+
+
+enum J_FS_WALK_OPTIONS {
+    J_FS_WALK_INCLUDE_FOLDER,
+    J_FS_WALK_INCLUDE_REGULAR,
+    J_FS_WALK_ORDER_LEXICOGRAPHIC, // TODO: William Implement me
+    J_FS_WALK_COUNT_FOLDER_ENTRIES, // TODO: William Implement me
+    J_FS_WALK_INCLUDE_DOT, // TODO: William Implement me
+    J_FS_WALK_INCLUDE_DOTDOT, // TODO: William Implement me
+};
+
+typedef struct Path {
+    Str  * _Nullable components;
+} Path;
+
+typedef struct FS_Dir {
+    DIR * _Nullable dir;
+    i32 remaining_entries;
+} FS_Dir;
+
+// Currently only supports directories and files.
+// TODO: William Give this an arena allocator to cleanup the memory easier.
+typedef struct FS_Walker {
+    FS_Dir * _Nullable open_directories;
+    Path path;
+    u32 options;
+} FS_Walker;
+
+typedef struct FS_Entry {
+    bool is_last;
+    struct dirent * _Nullable dirent;
+} FS_Entry;
+
+_j_stamp_maybe(FS_Walker);
+_j_stamp_maybe(FS_Entry);
+// MARK: - Bit Field
+
+#define j_bit_set(field, bit) ((field) |= (cast(typeof(field), 1) << (bit)))
+#define j_bit_check(field, bit) (!!((field) & (cast(typeof(field), 1) << (bit))))
+
+// MARK: - Bitset
+
+/**
+ * @brief A growable bit vector stored in u64 words, allocated from an arena. word_cap words are allocated and every
+ * bit past len is zero, so growing within the capacity only has to move len.
+ * ranks is only present after j_bitset_build_rank and holds the number of set bits before every 512 bit block.
+ */
+typedef struct Bitset {
+    u64 * _Nullable words;
+    u64 len;
+    u64 word_cap;
+    u64 * _Nullable ranks;
+} Bitset;
+
+#define J_BITSET_RANK_BLOCK_WORDS 8
+#define j_bitset_word_count(len) (((len) + 63) / 64)
+#define j_bitset_set(bs, i) ((bs)->words[(i) >> 6] |= 1ull << ((i) & 63))
+#define j_bitset_clear(bs, i) ((bs)->words[(i) >> 6] &= ~(1ull << ((i) & 63)))
+#define j_bitset_flip(bs, i) ((bs)->words[(i) >> 6] ^= 1ull << ((i) & 63))
+#define j_bitset_test(bs, i) (!!((bs)->words[(i) >> 6] & (1ull << ((i) & 63))))
+
+/**
+ * @brief Allocates a bitset of len bits, all cleared.
+ */
+Bitset j_make_bitset(Arena * _Nonnull arena, u64 len);
+/**
+ * @brief Sets the length to new_len bits. New bits are cleared, and the storage at least doubles when it has to
+ * grow, so growing one bit at a time is amortised O(1). The rank directory is dropped.
+ */
+void j_bitset_resize(Bitset * _Nonnull bs, Arena * _Nonnull arena, u64 new_len);
+/**
+ * @brief Appends one bit, growing the bitset when needed.
+ */
+void j_bitset_push(Bitset * _Nonnull bs, Arena * _Nonnull arena, bool value);
+void j_bitset_fill(Bitset * _Nonnull bs, bool value);
+/**
+ * @brief Word at a time set operations, dst = dst op src.
+ * Precondition: Both bitsets must have the same length.
+ */
+void j_bitset_and(Bitset * _Nonnull dst, const Bitset * _Nonnull src);
+void j_bitset_or(Bitset * _Nonnull dst, const Bitset * _Nonnull src);
+void j_bitset_xor(Bitset * _Nonnull dst, const Bitset * _Nonnull src);
+/**
+ * @brief Number of set bits.
+ */
+u64 j_bitset_count(const Bitset * _Nonnull bs);
+/**
+ * @brief Index of the first set bit at or after from.
+ */
+j_maybe(u64) j_bitset_next_set(const Bitset * _Nonnull bs, u64 from);
+/**
+ * @brief Builds the rank directory used by j_bitset_rank and j_bitset_select. It must be rebuilt after the bits change.
+ */
+void j_bitset_build_rank(Bitset * _Nonnull bs, Arena * _Nonnull arena);
+/**
+ * @brief Number of set bits before position i.
+ * Precondition: The rank directory must be built and i must be at most len.
+ */
+u64 j_bitset_rank(const Bitset * _Nonnull bs, u64 i);
+/**
+ * @brief Position of the k-th set bit, counting from zero.
+ * Precondition: The rank directory must be built.
+ */
+j_maybe(u64) j_bitset_select(const Bitset * _Nonnull bs, u64 k);
+
+
+
+static void init_printers(Arena *arena);
+
+
+static u64 j_hmap_generic_hash(const void *key, size_t len);
+static bool j_hmap_generic_compare(const void *lhs, const void *rhs, size_t len);
+
+#define j_hmap(ktp, vtp) j_maybe( j_pair(ktp,vtp) ) * _Nullable
+#define EMPTY_HMAP NULL
+
+typedef struct HMapHeader {
+    u32 cap; // It is going to be quite expensive to realloc the map because we need to rehash all the keys.
+    u32 len;
+    bool (*compare)(const void *lhs, const void *rhs, size_t len);
+    u64 (*hasher)(const void *key, size_t len);
+} HMapHeader;
+
+u32 j_hmap_get_slot_for_key(HMapHeader *map, void *key, size_t key_size, size_t entry_size);
+
+
+#define j_hmap_header(map) ((map) ? cast(HMapHeader *, map) - 1 : EMPTY_HMAP)
+#define _j_hmap_init_compare(map, compare_func) j_hmap_header(map)->compare = (compare_func)
+#define _j_hmap_init_hasher(map, hasher_func) j_hmap_header(map)->hasher = (hasher_func)
+#define j_hmap_init(map, hasher_func, compare_func, capacity) \
+({                       \
+    if ((map) == EMPTY_HMAP) { \
+        (map) = calloc(capacity, sizeof(map[0]) + sizeof(HMapHeader)) + sizeof(HMapHeader); \
+        j_hmap_header(map)->len = 0;                                                   \
+        j_hmap_header(map)->cap = (capacity);      \
+        _j_hmap_init_compare(map, compare_func);                                        \
+        _j_hmap_init_hasher(map, hasher_func);                                        \
+    }                                      \
+})
+
+#define j_hmap_cap(map) ((map) ? j_hmap_header(map)->cap : 0)
+#define j_hmap_len(map) ((map) ? j_hmap_header(map)->len : 0)
+#define _j_hmap_next_size(map) (j_hmap_cap(map) * sizeof(map[0]) * 2)
+#define j_hmap_put(map, key, valuet) \
+({                                  \
+    j_hmap_init(map, j_hmap_generic_hash, j_hmap_generic_compare, 10); \
+    jassert(j_hmap_len(map) < j_hmap_cap(map), "Precondition: There must be room for the entry inside the hashmap"); \
+    u32 index = j_hmap_get_slot_for_key(j_hmap_header(map), &key, sizeof(key), sizeof(map[0])); \
+    map[index].value.first = key;   \
+    map[index].value.second = (valuet);\
+    map[index].is_present = true;   \
+})
+#define j_hmap_remove(map, key) \
+({                              \
+    u32 index = j_hmap_get_slot_for_key(j_hmap_header(map), &key, sizeof(key), sizeof(map[0])); \
+    jassert(map[index].is_present == true, "Precondition: The key MUST be in the map before removing it!\n"); \
+    map[index].is_present = false;                                                              \
+    j_hmap_header(map)->len--;  \
+})
+#define j_hmap_removeAll(map) do \
+{                               \
+    for (u32 i = 0; i < j_hmap_cap(map); i++) { \
+        map[i].is_present = false; \
+    }                           \
+    j_hmap_header(map)->len = 0; \
+} while(0)
+#define j_hmap_get(map, key) ({ \
+    u32 index = j_hmap_header(map)->hasher(&key, sizeof(key)) % j_hmap_cap(map); \
+    u32 offset = 0;                            \
+    while (j_hmap_header(map)->compare(&map[(index+offset)].value.first, &key, sizeof(key)) == false) { \
+        offset += 1;            \
+        if (index+offset == j_hmap_cap(map)) {                                   \
+            index = 0;                        \
+        }                        \
+        jassert(offset < j_hmap_cap(map), "Precondition: The key must exist in the hmap before calling this function.\n"); \
+    }                           \
+    print("Get on Index: {u32}\n", (index + offset));           \
+    map[(index+offset)].value.second;                          \
+})
+#define j_hmap_is_empty(map) (j_hmap_len(map) == 0)
+#define j_hmap_iter_next(map, it) ({ \
+    u32 index = (it).value + 1; \
+    while (index < j_hmap_cap(map)) { \
+        if (map[index].is_present) { \
+            break; \
+        } \
+        index++; \
+    }                       \
+    Maybeu32 res = {0};                        \
+    if (index == j_hmap_cap(map)) {   \
+        res.is_present = false;\
+    } else {                \
+        res.is_present = true;        \
+        res.value = index;  \
+    }                       \
+    res;                    \
+})
+#define j_hmap_iter(map) j_hmap_iter_next(map, ((Maybeu32){false, -1}))
+#define j_hmap_iter_get(map, it) (jassert((it).is_present == true, "Precondition: Cannot call get on an nil value"), map[(it).value].value)
+
+#endif
+#ifdef JLIB_IMPL
+
+// MARK: - Red Black Tree Implementation
+
+static void _j_rb_recount(void *tree, u32 descriptor) {
+    j_rb_header(tree)->size_for[descriptor] = j_rb_size(tree, j_rb_left(tree, descriptor)) + j_rb_size(tree, j_rb_right(tree, descriptor)) + 1;
+}
+
+void _j_rb_update_size(void *tree, j_maybe(u32) descriptor) {
+    if (j_rb_header(tree)->size_for == NULL) {
+        return;
+    }
+    while_let(current, descriptor, {
+        _j_rb_recount(tree, current);
+        descriptor = j_rb_parent(tree, current);
+    })
+}
+
+void _j_rb_grow_path(void *tree, u32 descriptor) {
+    u32 *size_for = j_rb_header(tree)->size_for;
+    if (size_for == NULL) {
+        return;
+    }
+    size_for[descriptor] = 1;
+    j_maybe(u32) mparent = j_rb_parent(tree, descriptor);
+    while_let(parent, mparent, {
+        size_for[parent]++;
+        mparent = j_rb_parent(tree, parent);
+    })
+}
+
+static u32 _j_rb_count_subtree(void *tree, j_maybe(u32) descriptor) {
+    if (descriptor.is_present == false) {
+        return 0;
+    }
+    u32 size = _j_rb_count_subtree(tree, j_rb_left(tree, descriptor.value))
+             + _j_rb_count_subtree(tree, j_rb_right(tree, descriptor.value)) + 1;
+    j_rb_header(tree)->size_for[descriptor.value] = size;
+    return size;
+}
+
+void _j_rb_enable_rank(void *tree) {
+    RBTreeHeader *header = j_rb_header(tree);
+    if (header->size_for != NULL) {
+        return;
+    }
+    header->size_for = calloc(header->cap, sizeof(u32));
+    _j_rb_count_subtree(tree, header->root);
+}
+
+void *_j_rb_grow(void *tree, size_t node_size) {
+    u32 old_cap = j_rb_cap(tree);
+    u32 cap = old_cap > 0 ? old_cap * 2 : 10;
+    RBTreeHeader *header = realloc(j_rb_header(tree), sizeof(RBTreeHeader) + node_size * cap);
+    header->cap = cap;
+    // The new slots must read as nodes without links, like the calloc'ed ones.
+    header->parent_for = realloc(header->parent_for, sizeof(j_maybe(u32)) * cap);
+    header->left_child_for = realloc(header->left_child_for, sizeof(j_maybe(u32)) * cap);
+    header->right_child_for = realloc(header->right_child_for, sizeof(j_maybe(u32)) * cap);
+    header->color_for = realloc(header->color_for, sizeof(J_RB_COLOR) * cap);
+    memset(header->parent_for + old_cap, 0, sizeof(j_maybe(u32)) * (cap - old_cap));
+    memset(header->left_child_for + old_cap, 0, sizeof(j_maybe(u32)) * (cap - old_cap));
+    memset(header->right_child_for + old_cap, 0, sizeof(j_maybe(u32)) * (cap - old_cap));
+    memset(header->color_for + old_cap, 0, sizeof(J_RB_COLOR) * (cap - old_cap));
+    if (header->size_for != NULL) {
+        header->size_for = realloc(header->size_for, sizeof(u32) * cap);
+        memset(header->size_for + old_cap, 0, sizeof(u32) * (cap - old_cap));
+    }
+    return header + 1;
+}
+
+j_maybe(u32) j_rb_select(void *tree, u32 k) {
+    jassert(j_rb_header(tree)->size_for != NULL, "Precondition: Call j_rb_enable_rank before j_rb_select\n");
+    j_maybe(u32) mcurrent = j_rb_root(tree);
+    if (k >= j_rb_size(tree, mcurrent)) {
+        return (j_maybe(u32)) { .is_present = false };
+    }
+    while_let(current, mcurrent, {
+        u32 left_size = j_rb_size(tree, j_rb_left(tree, current));
+        if (k == left_size) {
+            break;
+        } else if (k < left_size) {
+            mcurrent = j_rb_left(tree, current);
+        } else {
+            k -= left_size + 1;
+            mcurrent = j_rb_right(tree, current);
+        }
+    })
+    return mcurrent;
+}
+
+
+void j_rb_delete(void *tree, u32 descriptor) {
+    u32 y = descriptor;
+    // x is the node that moves into the place of y. It may be nil, so its parent is tracked separately.
+    j_maybe(u32) x;
+    j_maybe(u32) x_parent = j_rb_parent(tree, descriptor);
+    J_RB_COLOR y_original_color = j_rb_color(tree, y);
+    // The lowest node whose subtree size changes. Everything above it is recounted once the node is unlinked.
+    j_maybe(u32) size_start = j_rb_parent(tree, descriptor);
+    if (j_rb_left(tree, descriptor).is_present == false) {
+        x = j_rb_right(tree, descriptor);
+        _j_rb_transplant(tree, descriptor, x);
+    } else if (j_rb_right(tree, descriptor).is_present == false) {
+        x = j_rb_left(tree, descriptor);
+        _j_rb_transplant(tree, descriptor, x);
+    } else {
+        y = _j_rb_right(tree, descriptor);
+        while (j_rb_left(tree, y).is_present) {
+            y = _j_rb_left(tree, y);
+        }
+        j_maybe(u32) my = { .is_present = true, .value = y };
+        y_original_color = j_rb_color(tree, y);
+        x = j_rb_right(tree, y);
+        if (_j_rb_parent(tree, y) == descriptor) {
+            x_parent = my;
+            size_start = my;
+        } else {
+            x_parent = j_rb_parent(tree, y);
+            size_start = j_rb_parent(tree, y);
+            _j_rb_transplant(tree, y, x);
+            j_rb_right(tree, y) = j_rb_right(tree, descriptor);
+            j_rb_parent(tree, _j_rb_right(tree, y)) = my;
+        }
+        _j_rb_transplant(tree, descriptor, my);
+        j_rb_left(tree, y) = j_rb_left(tree, descriptor);
+        j_rb_parent(tree, _j_rb_left(tree, y)) = my;
+        j_rb_color(tree, y) = j_rb_color(tree, descriptor);
+    }
+    _j_rb_update_size(tree, size_start);
+    if (y_original_color == J_RB_BLACK) {
+        _j_rb_delete_fixup(tree, x, x_parent);
+    }
+}
+
+void _j_rb_left_rotate(void *tree, u32 descriptor) {
+    // We know y is present;
+    j_maybe(u32) y = j_rb_right(tree, descriptor);
+    j_maybe(u32) yleft = j_rb_left(tree, y.value);
+    j_rb_right(tree, descriptor) = yleft;
+
+    if_let(left, yleft, {
+        j_rb_parent(tree, left) = ((j_maybe(u32)) { .is_present = true, .value = descriptor});
+    })
+    j_rb_parent(tree, y.value) = j_rb_parent(tree, descriptor);
+    if (j_rb_parent(tree, descriptor).is_present == false) {
+        j_rb_root(tree) = y;
+    } else if (_j_rb_is_left_sibling(tree, descriptor)) {
+        j_rb_left(tree, j_rb_parent(tree, descriptor).value) = y;
+    } else {
+        j_rb_right(tree, j_rb_parent(tree, descriptor).value) = y;
+    }
+
+    j_rb_left(tree, y.value) = ((j_maybe(u32)) { .value = descriptor, .is_present = true });
+    j_rb_parent(tree, descriptor) = y;
+
+    if (j_rb_header(tree)->size_for != NULL) {
+        j_rb_header(tree)->size_for[y.value] = j_rb_header(tree)->size_for[descriptor];
+        _j_rb_recount(tree, descriptor);
+    }
+}
+
+void _j_rb_right_rotate(void *tree, u32 descriptor) {
+    // We know y is present;
+    j_maybe(u32) y = j_rb_left(tree, descriptor);
+    j_maybe(u32) yright = j_rb_right(tree, y.value);
+    j_rb_left(tree, descriptor) = yright;
+
+    if_let(right, yright, {
+        j_rb_parent(tree, right) = ((j_maybe(u32)) { .is_present = true, .value = descriptor});
+    })
+    j_rb_parent(tree, y.value) = j_rb_parent(tree, descriptor);
+    if (j_rb_parent(tree, descriptor).is_present == false) {
+        j_rb_root(tree) = y;
+    } else if (_j_rb_is_right_sibling(tree, descriptor)) {
+        j_rb_right(tree, j_rb_parent(tree, descriptor).value) = y;
+    } else {
+        j_rb_left(tree, j_rb_parent(tree, descriptor).value) = y;
+    }
+
+    j_rb_right(tree, y.value) = ((j_maybe(u32)) { .value = descriptor, .is_present = true });
+    j_rb_parent(tree, descriptor) = y;
+
+    if (j_rb_header(tree)->size_for != NULL) {
+        j_rb_header(tree)->size_for[y.value] = j_rb_header(tree)->size_for[descriptor];
+        _j_rb_recount(tree, descriptor);
+    }
+}
+
+void _j_rb_insert_fixup(void *tree, u32 descriptor) {
+    while (j_rb_parent(tree, descriptor).is_present && j_rb_color(tree, _j_rb_parent(tree, descriptor)) == J_RB_RED) {
+        j_maybe(u32) my;
+        if (_j_rb_is_left_sibling(tree, _j_rb_parent(tree, descriptor))) {
+            u32 y = _j_rb_right(tree, _j_rb_grandparent(tree, descriptor));
+            if (j_rb_right(tree, _j_rb_grandparent(tree, descriptor)).is_present && j_rb_color(tree, y) == J_RB_RED) {
+                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
+                j_rb_color(tree, y) = J_RB_BLACK;
+                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
+                descriptor = _j_rb_grandparent(tree, descriptor);
+            } else {
+                if (_j_rb_is_right_sibling(tree, descriptor)) {
+                    descriptor = _j_rb_parent(tree, descriptor);
+                    _j_rb_left_rotate(tree, descriptor);
+                }
+                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
+                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
+                _j_rb_right_rotate(tree, _j_rb_grandparent(tree, descriptor));
+            }
+        } else  {
+            u32 y = _j_rb_left(tree, _j_rb_grandparent(tree, descriptor));
+            if (j_rb_left(tree, _j_rb_grandparent(tree, descriptor)).is_present && j_rb_color(tree, y) == J_RB_RED) {
+                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
+                j_rb_color(tree, y) = J_RB_BLACK;
+                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
+                descriptor = _j_rb_grandparent(tree, descriptor);
+            } else {
+                if (_j_rb_is_left_sibling(tree, descriptor)) {
+                    descriptor = _j_rb_parent(tree, descriptor);
+                    _j_rb_right_rotate(tree, descriptor);
+                }
+                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
+                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
+                _j_rb_left_rotate(tree, _j_rb_grandparent(tree, descriptor));
+            }
+        }
+
+    }
+    j_rb_color(tree, j_rb_root(tree).value) = J_RB_BLACK;
+}
+
+#define _j_rb_is_black(tree, mdescriptor) ((mdescriptor).is_present == false || j_rb_color(tree, (mdescriptor).value) == J_RB_BLACK)
+#define _j_rb_is_same(lhs, rhs) ((lhs).is_present == (rhs).is_present && ((lhs).is_present == false || (lhs).value == (rhs).value))
+
+void _j_rb_delete_fixup(void *tree, j_maybe(u32) descriptor, j_maybe(u32) mparent) {
+    // Nil nodes count as black, so descriptor may be nil while it is below the root.
+    while (_j_rb_is_same(descriptor, j_rb_root(tree)) == false && _j_rb_is_black(tree, descriptor)) {
+        u32 parent = mparent.value;
+        if (_j_rb_is_same(descriptor, j_rb_left(tree, parent))) {
+            // The sibling exists since descriptor is one black node short.
+            u32 sibling = _j_rb_right(tree, parent);
+            if (j_rb_color(tree, sibling) == J_RB_RED) {
+                j_rb_color(tree, sibling) = J_RB_BLACK;
+                j_rb_color(tree, parent) = J_RB_RED;
+                _j_rb_left_rotate(tree, parent);
+                sibling = _j_rb_right(tree, parent);
+            }
+            if (_j_rb_is_black(tree, j_rb_left(tree, sibling)) && _j_rb_is_black(tree, j_rb_right(tree, sibling))) {
+                j_rb_color(tree, sibling) = J_RB_RED;
+                descriptor = mparent;
+                mparent = j_rb_parent(tree, parent);
+            } else {
+                if (_j_rb_is_black(tree, j_rb_right(tree, sibling))) {
+                    j_rb_color(tree, _j_rb_left(tree, sibling)) = J_RB_BLACK;
+                    j_rb_color(tree, sibling) = J_RB_RED;
+                    _j_rb_right_rotate(tree, sibling);
+                    sibling = _j_rb_right(tree, parent);
+                }
+                j_rb_color(tree, sibling) = j_rb_color(tree, parent);
+                j_rb_color(tree, parent) = J_RB_BLACK;
+                j_rb_color(tree, _j_rb_right(tree, sibling)) = J_RB_BLACK;
+                _j_rb_left_rotate(tree, parent);
+                descriptor = j_rb_root(tree);
+            }
+        } else {
+            u32 sibling = _j_rb_left(tree, parent);
+            if (j_rb_color(tree, sibling) == J_RB_RED) {
+                j_rb_color(tree, sibling) = J_RB_BLACK;
+                j_rb_color(tree, parent) = J_RB_RED;
+                _j_rb_right_rotate(tree, parent);
+                sibling = _j_rb_left(tree, parent);
+            }
+            if (_j_rb_is_black(tree, j_rb_left(tree, sibling)) && _j_rb_is_black(tree, j_rb_right(tree, sibling))) {
+                j_rb_color(tree, sibling) = J_RB_RED;
+                descriptor = mparent;
+                mparent = j_rb_parent(tree, parent);
+            } else {
+                if (_j_rb_is_black(tree, j_rb_left(tree, sibling))) {
+                    j_rb_color(tree, _j_rb_right(tree, sibling)) = J_RB_BLACK;
+                    j_rb_color(tree, sibling) = J_RB_RED;
+                    _j_rb_left_rotate(tree, sibling);
+                    sibling = _j_rb_left(tree, parent);
+                }
+                j_rb_color(tree, sibling) = j_rb_color(tree, parent);
+                j_rb_color(tree, parent) = J_RB_BLACK;
+                j_rb_color(tree, _j_rb_left(tree, sibling)) = J_RB_BLACK;
+                _j_rb_right_rotate(tree, parent);
+                descriptor = j_rb_root(tree);
+            }
+        }
+    }
+    if_let(current, descriptor, {
+        j_rb_color(tree, current) = J_RB_BLACK;
+    })
+}
+
+#undef _j_rb_is_black
+#undef _j_rb_is_same
+
+j_maybe(u32) _j_rb_minimum(void *tree, j_maybe(u32) descriptor) {
+    if_let(current, descriptor, {
+        while (j_rb_left(tree, current).is_present) {
+            current = _j_rb_left(tree, current);
+        }
+        descriptor.value = current;
+    })
+    return descriptor;
+}
+
+j_maybe(u32) _j_rb_successor(void *tree, u32 descriptor) {
+    if (j_rb_right(tree, descriptor).is_present) {
+        return _j_rb_minimum(tree, j_rb_right(tree, descriptor));
+    }
+    while (_j_rb_is_right_sibling(tree, descriptor)) {
+        descriptor = _j_rb_parent(tree, descriptor);
+    }
+    return j_rb_parent(tree, descriptor);
+}
+
+void _j_rb_link_bfs(void *tree, u32 n) {
+    // The depth of the last level. Only that level may be partially filled.
+    u32 last_depth = 0;
+    while ((cast(u64, 2) << last_depth) - 1 < n) {
+        last_depth++;
+    }
+    bool last_is_full = (cast(u64, 2) << last_depth) - 1 == n;
+    u32 depth = 0;
+    for (u64 i = 0; i < n; ++i) {
+        if (i + 1 == (cast(u64, 1) << (depth + 1))) {
+            depth++;
+        }
+        j_rb_parent(tree, i) = i == 0 ? ((j_maybe(u32)) { .is_present = false }) : ((j_maybe(u32)) { .is_present = true, .value = (i - 1) / 2 });
+        j_rb_left(tree, i) = 2 * i + 1 < n ? ((j_maybe(u32)) { .is_present = true, .value = 2 * i + 1 }) : ((j_maybe(u32)) NIL);
+        j_rb_right(tree, i) = 2 * i + 2 < n ? ((j_maybe(u32)) { .is_present = true, .value = 2 * i + 2 }) : ((j_maybe(u32)) NIL);
+        j_rb_color(tree, i) = depth == last_depth && depth > 0 && last_is_full == false ? J_RB_RED : J_RB_BLACK;
+    }
+    j_rb_root(tree) = ((j_maybe(u32)) { .is_present = n > 0, .value = 0 });
+    j_rb_header(tree)->len = n;
+}
+
+// MARK: - B+ Tree Implementation
+
+#define _j_btree_align(offset) (((offset) + 15) & ~cast(u32, 15))
+
+static BTreeNode *_j_btree_make_node(bool is_leaf) {
+    BTreeNode *node = aligned_alloc(64, J_BTREE_NODE_SIZE);
+    jassert(node != NULL, "Could not allocate memory for the B+ tree node\n");
+    node->count = 0;
+    node->is_leaf = is_leaf;
+    node->next = NULL;
+    return node;
+}
+
+void _j_btree_init_header(BTreeHeader *header, u32 key_size, u32 value_size) {
+    u32 leaf_cap = (J_BTREE_NODE_SIZE - sizeof(BTreeNode)) / (key_size + value_size);
+    while (_j_btree_align(sizeof(BTreeNode) + leaf_cap * key_size) + leaf_cap * value_size > J_BTREE_NODE_SIZE) {
+        leaf_cap--;
+    }
+    u32 inner_cap = (J_BTREE_NODE_SIZE - sizeof(BTreeNode) - sizeof(BTreeNode *)) / (key_size + sizeof(BTreeNode *));
+    while (_j_btree_align(sizeof(BTreeNode) + inner_cap * key_size) + (inner_cap + 1) * sizeof(BTreeNode *) > J_BTREE_NODE_SIZE) {
+        inner_cap--;
+    }
+    jassert(leaf_cap >= 3 && inner_cap >= 3, "Precondition: The key and value must be small enough to fit three entries in a node\n");
+
+    header->len = 0;
+    header->height = 1;
+    header->key_size = key_size;
+    header->value_size = value_size;
+    header->leaf_cap = leaf_cap;
+    header->inner_cap = inner_cap;
+    header->values_offset = _j_btree_align(sizeof(BTreeNode) + leaf_cap * key_size);
+    header->children_offset = _j_btree_align(sizeof(BTreeNode) + inner_cap * key_size);
+    header->root = _j_btree_make_node(true);
+}
+
+void _j_btree_insert_at(BTreeHeader *header, BTreeNode **path, u32 *slot, u32 depth, BTreeNode *leaf, u32 index, const void *key, const void *value) {
+    u32 ksz = header->key_size;
+    u32 vsz = header->value_size;
+    u8 *keys = _j_btree_keys(leaf);
+    u8 *values = _j_btree_values(header, leaf);
+    header->len++;
+
+    if (leaf->count < header->leaf_cap) {
+        memmove(keys + (index + 1) * ksz, keys + index * ksz, (leaf->count - index) * ksz);
+        memmove(values + (index + 1) * vsz, values + index * vsz, (leaf->count - index) * vsz);
+        memcpy(keys + index * ksz, key, ksz);
+        memcpy(values + index * vsz, value, vsz);
+        leaf->count++;
+        return;
+    }
+
+    // The leaf is full. Lay out all cap + 1 entries in order and split them between the leaf and a new right sibling.
+    u8 all_keys[J_BTREE_NODE_SIZE * 2];
+    u8 all_values[J_BTREE_NODE_SIZE * 2];
+    u32 total = leaf->count + 1;
+    memcpy(all_keys, keys, index * ksz);
+    memcpy(all_keys + index * ksz, key, ksz);
+    memcpy(all_keys + (index + 1) * ksz, keys + index * ksz, (leaf->count - index) * ksz);
+    memcpy(all_values, values, index * vsz);
+    memcpy(all_values + index * vsz, value, vsz);
+    memcpy(all_values + (index + 1) * vsz, values + index * vsz, (leaf->count - index) * vsz);
+
+    BTreeNode *right = _j_btree_make_node(true);
+    u32 left_count = total / 2;
+    u32 right_count = total - left_count;
+    memcpy(keys, all_keys, left_count * ksz);
+    memcpy(values, all_values, left_count * vsz);
+    memcpy(_j_btree_keys(right), all_keys + left_count * ksz, right_count * ksz);
+    memcpy(_j_btree_values(header, right), all_values + left_count * vsz, right_count * vsz);
+    leaf->count = left_count;
+    right->count = right_count;
+    right->next = leaf->next;
+    leaf->next = right;
+
+    // Push the separator upwards. Keys equal to the separator live in the right subtree.
+    u8 separator[J_BTREE_NODE_SIZE];
+    memcpy(separator, _j_btree_keys(right), ksz);
+    BTreeNode *new_child = right;
+    while (depth > 0) {
+        depth--;
+        BTreeNode *node = path[depth];
+        u32 position = slot[depth];
+        u8 *node_keys = _j_btree_keys(node);
+        BTreeNode **children = _j_btree_children(header, node);
+        if (node->count < header->inner_cap) {
+            memmove(node_keys + (position + 1) * ksz, node_keys + position * ksz, (node->count - position) * ksz);
+            memmove(children + position + 2, children + position + 1, (node->count - position) * sizeof(BTreeNode *));
+            memcpy(node_keys + position * ksz, separator, ksz);
+            children[position + 1] = new_child;
+            node->count++;
+            return;
+        }
+
+        BTreeNode *all_children[J_BTREE_NODE_SIZE / sizeof(BTreeNode *) + 2];
+        total = node->count + 1;
+        memcpy(all_keys, node_keys, position * ksz);
+        memcpy(all_keys + position * ksz, separator, ksz);
+        memcpy(all_keys + (position + 1) * ksz, node_keys + position * ksz, (node->count - position) * ksz);
+        memcpy(all_children, children, (position + 1) * sizeof(BTreeNode *));
+        all_children[position + 1] = new_child;
+        memcpy(all_children + position + 2, children + position + 1, (node->count - position) * sizeof(BTreeNode *));
+
+        // The middle key moves up into the parent and is not kept in either half.
+        BTreeNode *sibling = _j_btree_make_node(false);
+        u32 middle = total / 2;
+        memcpy(node_keys, all_keys, middle * ksz);
+        memcpy(children, all_children, (middle + 1) * sizeof(BTreeNode *));
+        memcpy(_j_btree_keys(sibling), all_keys + (middle + 1) * ksz, (total - middle - 1) * ksz);
+        memcpy(_j_btree_children(header, sibling), all_children + middle + 1, (total - middle) * sizeof(BTreeNode *));
+        node->count = middle;
+        sibling->count = total - middle - 1;
+        memcpy(separator, all_keys + middle * ksz, ksz);
+        new_child = sibling;
+    }
+
+    // The root was split, so the tree grows by one level.
+    jassert(header->height < J_BTREE_MAX_HEIGHT, "The B+ tree exceeded its maximum height\n");
+    BTreeNode *root = _j_btree_make_node(false);
+    memcpy(_j_btree_keys(root), separator, ksz);
+    _j_btree_children(header, root)[0] = header->root;
+    _j_btree_children(header, root)[1] = new_child;
+    root->count = 1;
+    header->root = root;
+    header->height++;
+}
+
+j_maybe(BTreeCursor) _j_btree_normalize(BTreeCursor cursor) {
+    // Step to the next leaf at the end of this one. Only a root leaf can be empty, so this loops at most twice.
+    while (cursor.leaf != NULL && cursor.index >= cursor.leaf->count) {
+        cursor.leaf = cursor.leaf->next;
+        cursor.index = 0;
+    }
+    if (cursor.leaf == NULL) {
+        return (j_maybe(BTreeCursor)) { .is_present = false };
+    }
+    return (j_maybe(BTreeCursor)) { .is_present = true, .value = cursor };
+}
+
+j_maybe(BTreeCursor) _j_btree_first(BTreeHeader *header) {
+    BTreeNode *node = header->root;
+    while (node->is_leaf == false) {
+        node = _j_btree_children(header, node)[0];
+    }
+    return _j_btree_normalize((BTreeCursor) { .leaf = node, .index = 0 });
+}
+
+/**
+ * @brief Removes separator k and the child to its right from an inner node.
+ */
+static void _j_btree_remove_separator(BTreeHeader *header, BTreeNode *node, u32 k) {
+    u32 ksz = header->key_size;
+    u8 *keys = _j_btree_keys(node);
+    BTreeNode **children = _j_btree_children(header, node);
+    memmove(keys + k * ksz, keys + (k + 1) * ksz, (node->count - k - 1) * ksz);
+    memmove(children + k + 1, children + k + 2, (node->count - k - 1) * sizeof(BTreeNode *));
+    node->count--;
+}
+
+/**
+ * @brief Restores the fill of the inner node path[depth] after it lost a separator, climbing up while merges keep
+ * taking separators from the parents. An empty root is replaced by its only child.
+ */
+static void _j_btree_rebalance_inner(BTreeHeader *header, BTreeNode **path, u32 *slot, u32 depth) {
+    u32 ksz = header->key_size;
+    u32 min = header->inner_cap / 2;
+    while (true) {
+        BTreeNode *node = path[depth];
+        if (depth == 0) {
+            if (node->count == 0) {
+                header->root = _j_btree_children(header, node)[0];
+                header->height--;
+                free(node);
+            }
+            return;
+        }
+        if (node->count >= min) {
+            return;
+        }
+        BTreeNode *parent = path[depth - 1];
+        u32 position = slot[depth - 1];
+        u8 *parent_keys = _j_btree_keys(parent);
+        BTreeNode **siblings = _j_btree_children(header, parent);
+        BTreeNode *left = position > 0 ? siblings[position - 1] : NULL;
+        BTreeNode *right = position < parent->count ? siblings[position + 1] : NULL;
+        u8 *keys = _j_btree_keys(node);
+        BTreeNode **children = _j_btree_children(header, node);
+
+        if (left != NULL && left->count > min) {
+            // Rotate right: the separator comes down in front and the last key of the left sibling replaces it.
+            memmove(keys + ksz, keys, node->count * ksz);
+            memmove(children + 1, children, (node->count + 1) * sizeof(BTreeNode *));
+            memcpy(keys, parent_keys + (position - 1) * ksz, ksz);
+            children[0] = _j_btree_children(header, left)[left->count];
+            memcpy(parent_keys + (position - 1) * ksz, _j_btree_keys(left) + (left->count - 1) * ksz, ksz);
+            left->count--;
+            node->count++;
+            return;
+        }
+        if (right != NULL && right->count > min) {
+            // Rotate left: the separator comes down at the end and the first key of the right sibling replaces it.
+            u8 *right_keys = _j_btree_keys(right);
+            BTreeNode **right_children = _j_btree_children(header, right);
+            memcpy(keys + node->count * ksz, parent_keys + position * ksz, ksz);
+            children[node->count + 1] = right_children[0];
+            node->count++;
+            memcpy(parent_keys + position * ksz, right_keys, ksz);
+            memmove(right_keys, right_keys + ksz, (right->count - 1) * ksz);
+            memmove(right_children, right_children + 1, right->count * sizeof(BTreeNode *));
+            right->count--;
+            return;
+        }
+
+        // Neither sibling can spare a key. Merge with one of them, the separator between the two comes down.
+        if (left == NULL) {
+            left = node;
+            position++;
+        } else {
+            right = node;
+        }
+        u8 *left_keys = _j_btree_keys(left);
+        BTreeNode **left_children = _j_btree_children(header, left);
+        memcpy(left_keys + left->count * ksz, parent_keys + (position - 1) * ksz, ksz);
+        memcpy(left_keys + (left->count + 1) * ksz, _j_btree_keys(right), right->count * ksz);
+        memcpy(left_children + left->count + 1, _j_btree_children(header, right), (right->count + 1) * sizeof(BTreeNode *));
+        left->count += right->count + 1;
+        free(right);
+        _j_btree_remove_separator(header, parent, position - 1);
+        depth--;
+    }
+}
+
+void _j_btree_delete_at(BTreeHeader *header, BTreeNode **path, u32 *slot, u32 depth, BTreeNode *leaf, u32 index) {
+    u32 ksz = header->key_size;
+    u32 vsz = header->value_size;
+    u32 min = header->leaf_cap / 2;
+    u8 *keys = _j_btree_keys(leaf);
+    u8 *values = _j_btree_values(header, leaf);
+    u32 tail = leaf->count - index - 1;
+    memmove(keys + index * ksz, keys + (index + 1) * ksz, tail * ksz);
+    memmove(values + index * vsz, values + (index + 1) * vsz, tail * vsz);
+    leaf->count--;
+    header->len--;
+    // A separator may still equal the removed key. It keeps routing correctly, since every key left on its right is
+    // larger, so it is not updated.
+    if (depth == 0 || leaf->count >= min) {
+        return;
+    }
+
+    BTreeNode *parent = path[depth - 1];
+    u32 position = slot[depth - 1];
+    u8 *parent_keys = _j_btree_keys(parent);
+    BTreeNode **siblings = _j_btree_children(header, parent);
+    BTreeNode *left = position > 0 ? siblings[position - 1] : NULL;
+    BTreeNode *right = position < parent->count ? siblings[position + 1] : NULL;
+
+    if (left != NULL && left->count > min) {
+        // Move the last entry of the left sibling to the front of the leaf.
+        memmove(keys + ksz, keys, leaf->count * ksz);
+        memmove(values + vsz, values, leaf->count * vsz);
+        left->count--;
+        memcpy(keys, _j_btree_keys(left) + left->count * ksz, ksz);
+        memcpy(values, _j_btree_values(header, left) + left->count * vsz, vsz);
+        leaf->count++;
+        memcpy(parent_keys + (position - 1) * ksz, keys, ksz);
+        return;
+    }
+    if (right != NULL && right->count > min) {
+        // Move the first entry of the right sibling to the end of the leaf.
+        u8 *right_keys = _j_btree_keys(right);
+        u8 *right_values = _j_btree_values(header, right);
+        memcpy(keys + leaf->count * ksz, right_keys, ksz);
+        memcpy(values + leaf->count * vsz, right_values, vsz);
+        leaf->count++;
+        right->count--;
+        memmove(right_keys, right_keys + ksz, right->count * ksz);
+        memmove(right_values, right_values + vsz, right->count * vsz);
+        memcpy(parent_keys + position * ksz, right_keys, ksz);
+        return;
+    }
+
+    // Neither sibling can spare an entry. Merge the right one of the pair into the left one and unlink it.
+    if (left == NULL) {
+        left = leaf;
+        position++;
+    } else {
+        right = leaf;
+    }
+    memcpy(cast(u8 *, _j_btree_keys(left)) + left->count * ksz, _j_btree_keys(right), right->count * ksz);
+    memcpy(cast(u8 *, _j_btree_values(header, left)) + left->count * vsz, _j_btree_values(header, right), right->count * vsz);
+    left->count += right->count;
+    left->next = right->next;
+    free(right);
+    _j_btree_remove_separator(header, parent, position - 1);
+    _j_btree_rebalance_inner(header, path, slot, depth - 1);
+}
+
+static void _j_btree_free_node(BTreeHeader *header, BTreeNode *node) {
+    if (node->is_leaf == false) {
+        for (u32 i = 0; i <= node->count; ++i) {
+            _j_btree_free_node(header, _j_btree_children(header, node)[i]);
+        }
+    }
+    free(node);
+}
+
+void j_btree_free(void *tree) {
+    if (tree == EMPTY_BTREE) {
+        return;
+    }
+    BTreeHeader *header = j_btree_header(tree);
+    _j_btree_free_node(header, header->root);
+    free(header);
+}
+
+#undef _j_btree_align
+
+// MARK: - Persistent Red Black Tree Implementation
+
+// The balancing follows Kahrs, "Red-black trees with types" (2001). Every function returns fresh nodes and never
+// mutates its arguments, which is what makes the old versions stay valid.
+
+#define _j_prb_align(offset) (((offset) + 15) & ~cast(u32, 15))
+#define _j_prb_node_key(header, node) (cast(u8 *, node) + sizeof(PRBNode))
+#define _j_prb_node_value(header, node) (cast(u8 *, node) + (header)->value_offset)
+#define _j_prb_is_red(node) ((node) != NULL && (node)->color == J_RB_RED)
+#define _j_prb_is_black(node) ((node) != NULL && (node)->color == J_RB_BLACK)
+// Copy of the source node with new color and children.
+#define _j_prb_copy(header, color, left, source, right) \
+    (_j_prb_make(header, color, left, _j_prb_node_key(header, source), _j_prb_node_value(header, source), right))
+
+void _j_prb_init_header(PRBTreeHeader *header, Arena *arena, Arena *other_arena, u32 key_size, u32 value_size, i32 (*compare_func)(const void *lhs, const void *rhs)) {
+    jassert(arena->flags.allocation_scheme_linear && other_arena->flags.allocation_scheme_linear,
+            "Precondition: The arenas of a persistent tree must use the linear allocation scheme\n");
+    atomic_init(&header->root, NULL);
+    atomic_init(&header->epoch, 0);
+    atomic_init(&header->readers[0], 0);
+    atomic_init(&header->readers[1], 0);
+    header->arenas[0] = arena;
+    header->arenas[1] = other_arena;
+    header->active = 0;
+    atomic_init(&header->len, 0);
+    header->key_size = key_size;
+    header->value_size = value_size;
+    header->value_offset = _j_prb_align(sizeof(PRBNode) + key_size);
+    header->node_size = _j_prb_align(header->value_offset + value_size);
+    header->compare_func = compare_func;
+}
+
+static PRBNode *_j_prb_make(PRBTreeHeader *header, J_RB_COLOR color, PRBNode *left, const void *key, const void *value, PRBNode *right) {
+    PRBNode *node = j_alloc(header->arenas[header->active], header->node_size);
+    node->left = left;
+    node->right = right;
+    node->color = color;
+    memcpy(_j_prb_node_key(header, node), key, header->key_size);
+    memcpy(_j_prb_node_value(header, node), value, header->value_size);
+    return node;
+}
+
+static PRBNode *_j_prb_balance(PRBTreeHeader *header, PRBNode *a, const PRBNode *x, PRBNode *b) {
+    if (_j_prb_is_red(a) && _j_prb_is_red(b)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_copy(header, J_RB_BLACK, a->left, a, a->right), x, _j_prb_copy(header, J_RB_BLACK, b->left, b, b->right));
+    }
+    if (_j_prb_is_red(a) && _j_prb_is_red(a->left)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_copy(header, J_RB_BLACK, a->left->left, a->left, a->left->right), a, _j_prb_copy(header, J_RB_BLACK, a->right, x, b));
+    }
+    if (_j_prb_is_red(a) && _j_prb_is_red(a->right)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_copy(header, J_RB_BLACK, a->left, a, a->right->left), a->right, _j_prb_copy(header, J_RB_BLACK, a->right->right, x, b));
+    }
+    if (_j_prb_is_red(b) && _j_prb_is_red(b->right)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_copy(header, J_RB_BLACK, a, x, b->left), b, _j_prb_copy(header, J_RB_BLACK, b->right->left, b->right, b->right->right));
+    }
+    if (_j_prb_is_red(b) && _j_prb_is_red(b->left)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_copy(header, J_RB_BLACK, a, x, b->left->left), b->left, _j_prb_copy(header, J_RB_BLACK, b->left->right, b, b->right));
+    }
+    return _j_prb_copy(header, J_RB_BLACK, a, x, b);
+}
+
+static PRBNode *_j_prb_insert(PRBTreeHeader *header, PRBNode *node, const void *key, const void *value, bool *inserted) {
+    if (node == NULL) {
+        *inserted = true;
+        return _j_prb_make(header, J_RB_RED, NULL, key, value, NULL);
+    }
+    i32 compare_result = header->compare_func(key, _j_prb_node_key(header, node));
+    if (compare_result == 0) {
+        *inserted = false;
+        return _j_prb_make(header, node->color, node->left, key, value, node->right);
+    }
+    if (compare_result < 0) {
+        PRBNode *left = _j_prb_insert(header, node->left, key, value, inserted);
+        return node->color == J_RB_BLACK ? _j_prb_balance(header, left, node, node->right) : _j_prb_copy(header, J_RB_RED, left, node, node->right);
+    }
+    PRBNode *right = _j_prb_insert(header, node->right, key, value, inserted);
+    return node->color == J_RB_BLACK ? _j_prb_balance(header, node->left, node, right) : _j_prb_copy(header, J_RB_RED, node->left, node, right);
+}
+
+static PRBNode *_j_prb_redden(PRBTreeHeader *header, PRBNode *node) {
+    jassert(_j_prb_is_black(node), "Invariant: The node must be black\n");
+    return _j_prb_copy(header, J_RB_RED, node->left, node, node->right);
+}
+
+// The left subtree is one black node short.
+static PRBNode *_j_prb_balance_left(PRBTreeHeader *header, PRBNode *left, const PRBNode *x, PRBNode *right) {
+    if (_j_prb_is_red(left)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_copy(header, J_RB_BLACK, left->left, left, left->right), x, right);
+    }
+    if (_j_prb_is_black(right)) {
+        return _j_prb_balance(header, left, x, _j_prb_copy(header, J_RB_RED, right->left, right, right->right));
+    }
+    jassert(_j_prb_is_red(right) && _j_prb_is_black(right->left), "Invariant: The tree is not a valid red black tree\n");
+    return _j_prb_copy(header, J_RB_RED,
+                       _j_prb_copy(header, J_RB_BLACK, left, x, right->left->left),
+                       right->left,
+                       _j_prb_balance(header, right->left->right, right, _j_prb_redden(header, right->right)));
+}
+
+// The right subtree is one black node short.
+static PRBNode *_j_prb_balance_right(PRBTreeHeader *header, PRBNode *left, const PRBNode *x, PRBNode *right) {
+    if (_j_prb_is_red(right)) {
+        return _j_prb_copy(header, J_RB_RED, left, x, _j_prb_copy(header, J_RB_BLACK, right->left, right, right->right));
+    }
+    if (_j_prb_is_black(left)) {
+        return _j_prb_balance(header, _j_prb_copy(header, J_RB_RED, left->left, left, left->right), x, right);
+    }
+    jassert(_j_prb_is_red(left) && _j_prb_is_black(left->right), "Invariant: The tree is not a valid red black tree\n");
+    return _j_prb_copy(header, J_RB_RED,
+                       _j_prb_balance(header, _j_prb_redden(header, left->left), left, left->right->left),
+                       left->right,
+                       _j_prb_copy(header, J_RB_BLACK, left->right->right, x, right));
+}
+
+// Joins two subtrees where every key in left is less than every key in right.
+static PRBNode *_j_prb_append(PRBTreeHeader *header, PRBNode *left, PRBNode *right) {
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
+    }
+    if (_j_prb_is_red(left) && _j_prb_is_red(right)) {
+        PRBNode *middle = _j_prb_append(header, left->right, right->left);
+        if (_j_prb_is_red(middle)) {
+            return _j_prb_copy(header, J_RB_RED,
+                               _j_prb_copy(header, J_RB_RED, left->left, left, middle->left),
+                               middle,
+                               _j_prb_copy(header, J_RB_RED, middle->right, right, right->right));
+        }
+        return _j_prb_copy(header, J_RB_RED, left->left, left, _j_prb_copy(header, J_RB_RED, middle, right, right->right));
+    }
+    if (_j_prb_is_black(left) && _j_prb_is_black(right)) {
+        PRBNode *middle = _j_prb_append(header, left->right, right->left);
+        if (_j_prb_is_red(middle)) {
+            return _j_prb_copy(header, J_RB_RED,
+                               _j_prb_copy(header, J_RB_BLACK, left->left, left, middle->left),
+                               middle,
+                               _j_prb_copy(header, J_RB_BLACK, middle->right, right, right->right));
+        }
+        return _j_prb_balance_left(header, left->left, left, _j_prb_copy(header, J_RB_BLACK, middle, right, right->right));
+    }
+    if (_j_prb_is_red(right)) {
+        return _j_prb_copy(header, J_RB_RED, _j_prb_append(header, left, right->left), right, right->right);
+    }
+    return _j_prb_copy(header, J_RB_RED, left->left, left, _j_prb_append(header, left->right, right));
+}
+
+// Precondition: The key is in the subtree.
+static PRBNode *_j_prb_remove(PRBTreeHeader *header, PRBNode *node, const void *key) {
+    i32 compare_result = header->compare_func(key, _j_prb_node_key(header, node));
+    if (compare_result == 0) {
+        return _j_prb_append(header, node->left, node->right);
+    }
+    if (compare_result < 0) {
+        if (_j_prb_is_black(node->left)) {
+            return _j_prb_balance_left(header, _j_prb_remove(header, node->left, key), node, node->right);
+        }
+        return _j_prb_copy(header, J_RB_RED, _j_prb_remove(header, node->left, key), node, node->right);
+    }
+    if (_j_prb_is_black(node->right)) {
+        return _j_prb_balance_right(header, node->left, node, _j_prb_remove(header, node->right, key));
+    }
+    return _j_prb_copy(header, J_RB_RED, node->left, node, _j_prb_remove(header, node->right, key));
+}
+
+static void _j_prb_publish(PRBTreeHeader *header, PRBNode *root) {
+    if (_j_prb_is_red(root)) {
+        root = _j_prb_copy(header, J_RB_BLACK, root->left, root, root->right);
+    }
+    atomic_store_explicit(&header->root, root, memory_order_release);
+}
+
+bool _j_prb_put(PRBTreeHeader *header, const void *key, const void *value) {
+    bool inserted = false;
+    PRBNode *root = atomic_load_explicit(&header->root, memory_order_relaxed);
+    _j_prb_publish(header, _j_prb_insert(header, root, key, value, &inserted));
+    if (inserted) {
+        // There is a single writer, so a relaxed load and store is enough to keep the count exact.
+        atomic_store_explicit(&header->len, atomic_load_explicit(&header->len, memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+    return inserted;
+}
+
+bool _j_prb_delete(PRBTreeHeader *header, const void *key) {
+    PRBNode *root = atomic_load_explicit(&header->root, memory_order_relaxed);
+    if (_j_prb_find(header, root, key).is_present == false) {
+        return false;
+    }
+    _j_prb_publish(header, _j_prb_remove(header, root, key));
+    atomic_store_explicit(&header->len, atomic_load_explicit(&header->len, memory_order_relaxed) - 1, memory_order_relaxed);
+    return true;
+}
+
+j_maybe(PRBNodePtr) _j_prb_find(PRBTreeHeader *header, PRBNode *root, const void *key) {
+    PRBNode *node = root;
+    while (node != NULL) {
+        i32 compare_result = header->compare_func(key, _j_prb_node_key(header, node));
+        if (compare_result == 0) {
+            return (j_maybe(PRBNodePtr)) { .is_present = true, .value = node };
+        }
+        node = compare_result < 0 ? node->left : node->right;
+    }
+    return (j_maybe(PRBNodePtr)) { .is_present = false };
+}
+
+PRBVersion _j_prb_read_begin(PRBTreeHeader *header) {
+    while (true) {
+        u64 epoch = atomic_load(&header->epoch);
+        atomic_fetch_add(&header->readers[epoch % 2], 1);
+        // If the writer moved on in between, the reader may have been missed by j_prb_compact. Register again.
+        if (atomic_load(&header->epoch) == epoch) {
+            return (PRBVersion) { .root = atomic_load_explicit(&header->root, memory_order_acquire), .epoch = epoch };
+        }
+        atomic_fetch_sub(&header->readers[epoch % 2], 1);
+    }
+}
+
+void _j_prb_read_end(PRBTreeHeader *header, PRBVersion version) {
+    atomic_fetch_sub_explicit(&header->readers[version.epoch % 2], 1, memory_order_release);
+}
+
+static PRBNode *_j_prb_clone(PRBTreeHeader *header, PRBNode *node) {
+    if (node == NULL) {
+        return NULL;
+    }
+    return _j_prb_copy(header, node->color, _j_prb_clone(header, node->left), node, _j_prb_clone(header, node->right));
+}
+
+void _j_prb_compact(PRBTreeHeader *header) {
+    u64 epoch = atomic_load(&header->epoch);
+    Arena *old_arena = header->arenas[header->active];
+    // The other arena was reset by the previous compaction, so it only holds the copy.
+    header->active = 1 - header->active;
+    atomic_store(&header->root, _j_prb_clone(header, atomic_load_explicit(&header->root, memory_order_relaxed)));
+    // The root must be published before the epoch, so a reader of the new epoch can never see an old root.
+    atomic_store(&header->epoch, epoch + 1);
+    // Readers that registered under the old epoch may still hold roots into the old arena.
+    while (atomic_load(&header->readers[epoch % 2]) != 0) {
+        // Give the core to the readers, which may need it to finish on a machine with few cores.
+        sched_yield();
+    }
+    j_reset_arena(old_arena);
+}
+
+#undef _j_prb_align
+#undef _j_prb_node_key
+#undef _j_prb_node_value
+#undef _j_prb_is_red
+#undef _j_prb_is_black
+#undef _j_prb_copy
+
+// MARK: - Concurrent Skip List Implementation
+
+#define _j_sl_is_marked(link) (((link) & 1) != 0)
+#define _j_sl_ptr(link) (cast(SkipNode *, (link) & ~cast(uintptr_t, 1)))
+#define _j_sl_node_size(header, height) (sizeof(SkipNode) + (height) * sizeof(uintptr_t) + (((header)->key_size + 7) & ~cast(u32, 7)))
+
+void _j_sl_init_header(SkipListHeader *header, u32 key_size, i32 (*compare_func)(const void *lhs, const void *rhs)) {
+    header->key_size = key_size;
+    header->compare_func = compare_func;
+    header->head = malloc(_j_sl_node_size(header, J_SL_MAX_LEVEL));
+    header->head->height = J_SL_MAX_LEVEL;
+    for (u32 level = 0; level < J_SL_MAX_LEVEL; ++level) {
+        atomic_init(&header->head->next[level], 0);
+    }
+    atomic_init(&header->len, 0);
+    atomic_init(&header->epoch, 0);
+    atomic_init(&header->thread_count, 0);
+    for (u32 i = 0; i < J_SL_MAX_THREADS; ++i) {
+        atomic_init(&header->thread_epochs[i], 0);
+    }
+}
+
+SkipListThread _j_sl_register(SkipListHeader *header, Arena *arena) {
+    u32 id = atomic_fetch_add(&header->thread_count, 1);
+    jassert(id < J_SL_MAX_THREADS, "Too many threads registered with the skip list\n");
+    return (SkipListThread) {
+            .list = header,
+            .arena = arena,
+            .id = id,
+            .random_state = 0x9E3779B97F4A7C15UL * (id + 1),
+    };
+}
+
+void j_sl_enter(SkipListThread *thread) {
+    if (thread->nesting++ == 0) {
+        u64 epoch = atomic_load(&thread->list->epoch);
+        atomic_store(&thread->list->thread_epochs[thread->id], (epoch << 1) | 1);
+    }
+}
+
+void j_sl_leave(SkipListThread *thread) {
+    if (--thread->nesting == 0) {
+        atomic_store_explicit(&thread->list->thread_epochs[thread->id], 0, memory_order_release);
+    }
+}
+
+static void _j_sl_try_advance(SkipListHeader *header) {
+    u64 epoch = atomic_load(&header->epoch);
+    u32 count = atomic_load(&header->thread_count);
+    for (u32 i = 0; i < count; ++i) {
+        u64 state = atomic_load(&header->thread_epochs[i]);
+        if ((state & 1) && (state >> 1) != epoch) {
+            return;
+        }
+    }
+    atomic_compare_exchange_strong(&header->epoch, &epoch, epoch + 1);
+}
+
+static void _j_sl_release_limbo(SkipListThread *thread, u32 slot) {
+    SkipNode *node = thread->limbo[slot];
+    while (node != NULL) {
+        SkipNode *next = node->retired_next;
+        node->retired_next = thread->free_nodes[node->height];
+        thread->free_nodes[node->height] = node;
+        node = next;
+    }
+    thread->limbo[slot] = NULL;
+}
+
+// A node retired in epoch e may be reused once the global epoch reaches e + 2, since every thread that could
+// still see it has left its critical section by then.
+static void _j_sl_retire(SkipListThread *thread, SkipNode *node) {
+    u64 epoch = atomic_load(&thread->list->epoch);
+    for (u32 slot = 0; slot < 3; ++slot) {
+        if (thread->limbo[slot] != NULL && thread->limbo_epoch[slot] + 2 <= epoch) {
+            _j_sl_release_limbo(thread, slot);
+        }
+    }
+    u32 slot = epoch % 3;
+    node->retired_next = thread->limbo[slot];
+    thread->limbo[slot] = node;
+    thread->limbo_epoch[slot] = epoch;
+    _j_sl_try_advance(thread->list);
+}
+
+static u32 _j_sl_random_height(SkipListThread *thread) {
+    // xorshift64, each level is kept with probability 1/4.
+    u64 x = thread->random_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    thread->random_state = x;
+    u32 height = 1;
+    while (height < J_SL_MAX_LEVEL && (x & 3) == 0) {
+        height++;
+        x >>= 2;
+    }
+    return height;
+}
+
+static SkipNode *_j_sl_alloc(SkipListThread *thread, u32 height) {
+    SkipNode *node = thread->free_nodes[height];
+    if (node != NULL) {
+        thread->free_nodes[height] = node->retired_next;
+    } else {
+        node = j_alloc(thread->arena, _j_sl_node_size(thread->list, height));
+    }
+    node->height = height;
+    node->retired_next = NULL;
+    return node;
+}
+
+/**
+ * @brief Fills preds and succs with the neighbours of the key on every level and unlinks any marked node on the way.
+ * @return true if succs[0] holds the key.
+ */
+static bool _j_sl_search(SkipListHeader *header, const void *key, SkipNode **preds, SkipNode **succs) {
+retry:
+    {
+        SkipNode *pred = header->head;
+        for (i32 level = J_SL_MAX_LEVEL - 1; level >= 0; --level) {
+            SkipNode *curr = _j_sl_ptr(atomic_load(&pred->next[level]));
+            while (curr != NULL) {
+                uintptr_t succ = atomic_load(&curr->next[level]);
+                if (_j_sl_is_marked(succ)) {
+                    uintptr_t expected = cast(uintptr_t, curr);
+                    if (atomic_compare_exchange_strong(&pred->next[level], &expected, succ & ~cast(uintptr_t, 1)) == false) {
+                        goto retry;
+                    }
+                    curr = _j_sl_ptr(succ);
+                    continue;
+                }
+                if (header->compare_func(_j_sl_node_key(curr), key) >= 0) {
+                    break;
+                }
+                pred = curr;
+                curr = _j_sl_ptr(succ);
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+    }
+    return succs[0] != NULL && header->compare_func(_j_sl_node_key(succs[0]), key) == 0;
+}
+
+static void _j_sl_drop_pending(SkipListThread *thread, SkipNode *node) {
+    if (atomic_fetch_sub(&node->pending, 1) == 1) {
+        // Both the insert and the delete are done with the node. A search unlinks it from every level.
+        SkipNode *preds[J_SL_MAX_LEVEL];
+        SkipNode *succs[J_SL_MAX_LEVEL];
+        _j_sl_search(thread->list, _j_sl_node_key(node), preds, succs);
+        _j_sl_retire(thread, node);
+    }
+}
+
+bool _j_sl_put(SkipListThread *thread, const void *key, u64 value) {
+    SkipListHeader *header = thread->list;
+    SkipNode *preds[J_SL_MAX_LEVEL];
+    SkipNode *succs[J_SL_MAX_LEVEL];
+    j_sl_enter(thread);
+    SkipNode *node = NULL;
+    while (true) {
+        if (_j_sl_search(header, key, preds, succs)) {
+            atomic_store(&succs[0]->value, value);
+            if (node != NULL) {
+                // The node was never published, so it can be reused right away.
+                node->retired_next = thread->free_nodes[node->height];
+                thread->free_nodes[node->height] = node;
+            }
+            j_sl_leave(thread);
+            return false;
+        }
+        if (node == NULL) {
+            node = _j_sl_alloc(thread, _j_sl_random_height(thread));
+            memcpy(_j_sl_node_key(node), key, header->key_size);
+        }
+        atomic_store_explicit(&node->value, value, memory_order_relaxed);
+        atomic_store_explicit(&node->pending, 2, memory_order_relaxed);
+        for (u32 level = 0; level < node->height; ++level) {
+            atomic_store_explicit(&node->next[level], cast(uintptr_t, succs[level]), memory_order_relaxed);
+        }
+        uintptr_t expected = cast(uintptr_t, succs[0]);
+        if (atomic_compare_exchange_strong(&preds[0]->next[0], &expected, cast(uintptr_t, node))) {
+            break;
+        }
+    }
+    atomic_fetch_add(&header->len, 1);
+
+    // The node is in the list from here on. Link the upper levels unless a delete gets there first.
+    for (u32 level = 1; level < node->height; ++level) {
+        while (true) {
+            uintptr_t next = atomic_load(&node->next[level]);
+            if (_j_sl_is_marked(next)) {
+                goto linked;
+            }
+            if (_j_sl_ptr(next) != succs[level] &&
+                atomic_compare_exchange_strong(&node->next[level], &next, cast(uintptr_t, succs[level])) == false) {
+                goto linked;
+            }
+            uintptr_t expected = cast(uintptr_t, succs[level]);
+            if (atomic_compare_exchange_strong(&preds[level]->next[level], &expected, cast(uintptr_t, node))) {
+                break;
+            }
+            _j_sl_search(header, key, preds, succs);
+            if (succs[0] != node) {
+                goto linked;
+            }
+        }
+    }
+linked:
+    _j_sl_drop_pending(thread, node);
+    j_sl_leave(thread);
+    return true;
+}
+
+bool _j_sl_delete(SkipListThread *thread, const void *key) {
+    SkipNode *preds[J_SL_MAX_LEVEL];
+    SkipNode *succs[J_SL_MAX_LEVEL];
+    j_sl_enter(thread);
+    if (_j_sl_search(thread->list, key, preds, succs) == false) {
+        j_sl_leave(thread);
+        return false;
+    }
+    SkipNode *node = succs[0];
+    for (u32 level = node->height - 1; level > 0; --level) {
+        uintptr_t next = atomic_load(&node->next[level]);
+        while (_j_sl_is_marked(next) == false) {
+            atomic_compare_exchange_weak(&node->next[level], &next, next | 1);
+        }
+    }
+    // Marking the bottom level is the linearization point. Only one delete can win it.
+    uintptr_t next = atomic_load(&node->next[0]);
+    while (true) {
+        if (_j_sl_is_marked(next)) {
+            j_sl_leave(thread);
+            return false;
+        }
+        if (atomic_compare_exchange_weak(&node->next[0], &next, next | 1)) {
+            break;
+        }
+    }
+    atomic_fetch_sub(&thread->list->len, 1);
+    _j_sl_drop_pending(thread, node);
+    j_sl_leave(thread);
+    return true;
+}
 
-typedef struct FS_Dir {
-    DIR * _Nullable dir;
-    i32 remaining_entries;
-} FS_Dir;
+j_maybe(SkipNodePtr) _j_sl_find_node(SkipListThread *thread, const void *key, bool exact) {
+    jassert(thread->nesting > 0, "Precondition: The thread must be inside j_sl_enter\n");
+    SkipNode *preds[J_SL_MAX_LEVEL];
+    SkipNode *succs[J_SL_MAX_LEVEL];
+    bool found = _j_sl_search(thread->list, key, preds, succs);
+    if ((exact && found == false) || succs[0] == NULL) {
+        return (j_maybe(SkipNodePtr)) { .is_present = false };
+    }
+    return (j_maybe(SkipNodePtr)) { .is_present = true, .value = succs[0] };
+}
 
-// Currently only supports directories and files.
-// TODO: William Give this an arena allocator to cleanup the memory easier.
-typedef struct FS_Walker {
-    FS_Dir * _Nullable open_directories;
-    Path path;
-    u32 options;
-} FS_Walker;
+j_maybe(SkipNodePtr) _j_sl_next_live(SkipNode *node) {
+    SkipNode *next = _j_sl_ptr(atomic_load(&node->next[0]));
+    // Skip the nodes that are deleted but not unlinked yet.
+    while (next != NULL && _j_sl_is_marked(atomic_load(&next->next[0]))) {
+        next = _j_sl_ptr(atomic_load(&next->next[0]));
+    }
+    if (next == NULL) {
+        return (j_maybe(SkipNodePtr)) { .is_present = false };
+    }
+    return (j_maybe(SkipNodePtr)) { .is_present = true, .value = next };
+}
 
-typedef struct FS_Entry {
-    bool is_last;
-    struct dirent * _Nullable dirent;
-} FS_Entry;
+#undef _j_sl_is_marked
+#undef _j_sl_ptr
+#undef _j_sl_node_size
 
-_j_stamp_maybe(FS_Walker);
-_j_stamp_maybe(FS_Entry);
-// MARK: - Bit Field
+// MARK: - Sorting Implementation
 
-#define j_bit_set(field, bit) ((field) |= (cast(typeof(field), 1) << (bit)))
-#define j_bit_check(field, bit) (!!((field) & (cast(typeof(field), 1) << (bit))))
+static inline __attribute__((always_inline)) u64 _j_radix_load(const u8 *elem, u32 elem_size, J_RADIX_KEY kind) {
+    u64 key = 0;
+    memcpy(&key, elem, elem_size);
+    u64 sign = 1ull << (elem_size * 8 - 1);
+    switch (kind) {
+        case J_RADIX_UNSIGNED: return key;
+        case J_RADIX_SIGNED: return key ^ sign;
+        case J_RADIX_FLOAT: return key & sign ? ~key & (sign | (sign - 1)) : key | sign;
+    }
+    return key;
+}
 
+// Inlined once per element size and key kind, so the byte loads and key transforms compile to plain integer ops.
+static inline __attribute__((always_inline)) void _j_radix_sort_impl(u8 *data, u8 *scratch, u64 n, u32 elem_size, J_RADIX_KEY kind) {
+    u8 *src = data;
+    u8 *dst = scratch;
+    u64 counts[8][256] = {0};
+    for (u64 i = 0; i < n; ++i) {
+        u64 key = _j_radix_load(src + i * elem_size, elem_size, kind);
+        for (u32 byte = 0; byte < elem_size; ++byte) {
+            counts[byte][(key >> (byte * 8)) & 0xff]++;
+        }
+    }
+    for (u32 byte = 0; byte < elem_size; ++byte) {
+        u64 *count = counts[byte];
+        // Every key has the same digit, this pass would not move anything.
+        if (count[(_j_radix_load(src, elem_size, kind) >> (byte * 8)) & 0xff] == n) continue;
+        u64 offset = 0;
+        for (u32 digit = 0; digit < 256; ++digit) {
+            u64 c = count[digit];
+            count[digit] = offset;
+            offset += c;
+        }
+        for (u64 i = 0; i < n; ++i) {
+            u64 key = _j_radix_load(src + i * elem_size, elem_size, kind);
+            memcpy(dst + count[(key >> (byte * 8)) & 0xff]++ * elem_size, src + i * elem_size, elem_size);
+        }
+        u8 *temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != data) {
+        memcpy(data, src, n * elem_size);
+    }
+}
 
+#define _j_radix_sort_kinds(data, scratch, n, elem_size, kind) do { \
+    switch (kind) { \
+        case J_RADIX_UNSIGNED: _j_radix_sort_impl(data, scratch, n, elem_size, J_RADIX_UNSIGNED); break; \
+        case J_RADIX_SIGNED: _j_radix_sort_impl(data, scratch, n, elem_size, J_RADIX_SIGNED); break; \
+        case J_RADIX_FLOAT: _j_radix_sort_impl(data, scratch, n, elem_size, J_RADIX_FLOAT); break; \
+    } \
+} while(0)
 
-static void init_printers(Arena *arena);
+void j_radix_sort(void * _Nullable data, u64 n, u32 elem_size, J_RADIX_KEY kind, Arena * _Nonnull arena) {
+    if (n < 2) return;
+    u8 *scratch = j_alloc(arena, n * elem_size);
+    switch (elem_size) {
+        case 1: _j_radix_sort_kinds(data, scratch, n, 1, kind); break;
+        case 2: _j_radix_sort_kinds(data, scratch, n, 2, kind); break;
+        case 4: _j_radix_sort_kinds(data, scratch, n, 4, kind); break;
+        case 8: _j_radix_sort_kinds(data, scratch, n, 8, kind); break;
+        default: jassert(false, "Precondition: Radix sort only supports 1, 2, 4 and 8 byte keys\n");
+    }
+    j_free(arena, scratch, n * elem_size);
+}
 
+// MARK: - Thread Pool Implementation
 
-static u64 j_hmap_generic_hash(const void *key, size_t len);
-static bool j_hmap_generic_compare(const void *lhs, const void *rhs, size_t len);
+static _Thread_local PoolWorker *_j_pool_current = NULL;
 
-#define j_hmap(ktp, vtp) j_maybe( j_pair(ktp,vtp) ) * _Nullable
-#define EMPTY_HMAP NULL
+static PoolWorker *_j_pool_self(ThreadPool *pool) {
+    if (_j_pool_current != NULL && _j_pool_current->pool == pool) return _j_pool_current;
+    return &pool->workers[pool->worker_count];
+}
 
-typedef struct HMapHeader {
-    u32 cap; // It is going to be quite expensive to realloc the map because we need to rehash all the keys.
-    u32 len;
-    bool (*compare)(const void *lhs, const void *rhs, size_t len);
-    u64 (*hasher)(const void *key, size_t len);
-} HMapHeader;
+static void _j_pool_run(PoolWorker *self, PoolTask task) {
+    u64 mark = self->arena.stack.used;
+    task.func(task.ctx, task.begin, task.end, self);
+    self->arena.stack.used = mark;
+    atomic_fetch_sub_explicit(&task.group->pending, 1, memory_order_release);
+}
 
-u32 j_hmap_get_slot_for_key(HMapHeader *map, void *key, size_t key_size, size_t entry_size);
+static bool _j_pool_try_run(PoolWorker *self) {
+    ThreadPool *pool = self->pool;
+    PoolTask task;
+    bool found = false;
 
+    pthread_mutex_lock(&self->lock);
+    if (self->tail > self->head) {
+        task = self->tasks[--self->tail % J_POOL_QUEUE_CAP];
+        found = true;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    for (u32 i = 1; !found && i <= pool->worker_count; ++i) {
+        PoolWorker *victim = &pool->workers[(self->id + i) % (pool->worker_count + 1)];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->tail > victim->head) {
+            task = victim->tasks[victim->head++ % J_POOL_QUEUE_CAP];
+            found = true;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    if (!found) return false;
 
-#define j_hmap_header(map) ((map) ? cast(HMapHeader *, map) - 1 : EMPTY_HMAP)
-#define _j_hmap_init_compare(map, compare_func) j_hmap_header(map)->compare = (compare_func)
-#define _j_hmap_init_hasher(map, hasher_func) j_hmap_header(map)->hasher = (hasher_func)
-#define j_hmap_init(map, hasher_func, compare_func, capacity) \
-({                       \
-    if ((map) == EMPTY_HMAP) { \
-        (map) = calloc(capacity, sizeof(map[0]) + sizeof(HMapHeader)) + sizeof(HMapHeader); \
-        j_hmap_header(map)->len = 0;                                                   \
-        j_hmap_header(map)->cap = (capacity);      \
-        _j_hmap_init_compare(map, compare_func);                                        \
-        _j_hmap_init_hasher(map, hasher_func);                                        \
-    }                                      \
-})
+    atomic_fetch_sub_explicit(&pool->queued, 1, memory_order_relaxed);
+    _j_pool_run(self, task);
+    return true;
+}
 
-#define j_hmap_cap(map) ((map) ? j_hmap_header(map)->cap : 0)
-#define j_hmap_len(map) ((map) ? j_hmap_header(map)->len : 0)
-#define _j_hmap_next_size(map) (j_hmap_cap(map) * sizeof(map[0]) * 2)
-#define j_hmap_put(map, key, valuet) \
-({                                  \
-    j_hmap_init(map, j_hmap_generic_hash, j_hmap_generic_compare, 10); \
-    jassert(j_hmap_len(map) < j_hmap_cap(map), "Precondition: There must be room for the entry inside the hashmap"); \
-    u32 index = j_hmap_get_slot_for_key(j_hmap_header(map), &key, sizeof(key), sizeof(map[0])); \
-    map[index].value.first = key;   \
-    map[index].value.second = (valuet);\
-    map[index].is_present = true;   \
-})
-#define j_hmap_remove(map, key) \
-({                              \
-    u32 index = j_hmap_get_slot_for_key(j_hmap_header(map), &key, sizeof(key), sizeof(map[0])); \
-    jassert(map[index].is_present == true, "Precondition: The key MUST be in the map before removing it!\n"); \
-    map[index].is_present = false;                                                              \
-    j_hmap_header(map)->len--;  \
-})
-#define j_hmap_removeAll(map) do \
-{                               \
-    for (u32 i = 0; i < j_hmap_cap(map); i++) { \
-        map[i].is_present = false; \
-    }                           \
-    j_hmap_header(map)->len = 0; \
-} while(0)
-#define j_hmap_get(map, key) ({ \
-    u32 index = j_hmap_header(map)->hasher(&key, sizeof(key)) % j_hmap_cap(map); \
-    u32 offset = 0;                            \
-    while (j_hmap_header(map)->compare(&map[(index+offset)].value.first, &key, sizeof(key)) == false) { \
-        offset += 1;            \
-        if (index+offset == j_hmap_cap(map)) {                                   \
-            index = 0;                        \
-        }                        \
-        jassert(offset < j_hmap_cap(map), "Precondition: The key must exist in the hmap before calling this function.\n"); \
-    }                           \
-    print("Get on Index: {u32}\n", (index + offset));           \
-    map[(index+offset)].value.second;                          \
-})
-#define j_hmap_is_empty(map) (j_hmap_len(map) == 0)
-#define j_hmap_iter_next(map, it) ({ \
-    u32 index = (it).value + 1; \
-    while (index < j_hmap_cap(map)) { \
-        if (map[index].is_present) { \
-            break; \
-        } \
-        index++; \
-    }                       \
-    Maybeu32 res = {0};                        \
-    if (index == j_hmap_cap(map)) {   \
-        res.is_present = false;\
-    } else {                \
-        res.is_present = true;        \
-        res.value = index;  \
-    }                       \
-    res;                    \
-})
-#define j_hmap_iter(map) j_hmap_iter_next(map, ((Maybeu32){false, -1}))
-#define j_hmap_iter_get(map, it) (jassert((it).is_present == true, "Precondition: Cannot call get on an nil value"), map[(it).value].value)
+static void *_j_pool_worker_main(void *arg) {
+    PoolWorker *self = arg;
+    ThreadPool *pool = self->pool;
+    _j_pool_current = self;
+    while (true) {
+        if (_j_pool_try_run(self)) continue;
+        pthread_mutex_lock(&pool->sleep_lock);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->shutdown)) {
+            pthread_cond_wait(&pool->wake, &pool->sleep_lock);
+        }
+        bool done = atomic_load(&pool->shutdown) && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->sleep_lock);
+        if (done) return NULL;
+    }
+}
 
-#endif
-#ifdef JLIB_IMPL
+ThreadPool *j_make_thread_pool(u32 thread_count, u64 scratch_size) {
+    if (thread_count == 0) {
+        i64 cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 1 ? cast(u32, cores - 1) : 1;
+    }
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    jassert(pool != NULL, "Could not allocate memory for the thread pool\n");
+    pool->worker_count = thread_count;
+    pool->workers = calloc(thread_count + 1, sizeof(PoolWorker));
+    jassert(pool->workers != NULL, "Could not allocate memory for the thread pool\n");
+    pthread_mutex_init(&pool->sleep_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (u32 i = 0; i <= thread_count; ++i) {
+        PoolWorker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->id = i;
+        worker->arena = j_make_arena(scratch_size, false);
+        worker->arena.flags.allocation_scheme_linear = true;
+        worker->arena.flags.storage_duration_permanent = false;
+        worker->arena.flags.storage_duration_scratch = true;
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    for (u32 i = 0; i < thread_count; ++i) {
+        pthread_create(&pool->workers[i].thread, NULL, _j_pool_worker_main, &pool->workers[i]);
+    }
+    return pool;
+}
 
-// MARK: - Red Black Tree Implementation
+void j_thread_pool_destroy(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->sleep_lock);
+    atomic_store(&pool->shutdown, true);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+    for (u32 i = 0; i < pool->worker_count; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (u32 i = 0; i <= pool->worker_count; ++i) {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+        free(pool->workers[i].arena.stack.memory);
+    }
+    pthread_mutex_destroy(&pool->sleep_lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    free(pool);
+}
 
+void j_pool_submit(ThreadPool *pool, TaskGroup *group, PoolTaskFunc func, void *ctx, u64 begin, u64 end) {
+    PoolWorker *self = _j_pool_self(pool);
+    PoolTask task = { .func = func, .ctx = ctx, .begin = begin, .end = end, .group = group };
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+
+    pthread_mutex_lock(&self->lock);
+    bool full = self->tail - self->head == J_POOL_QUEUE_CAP;
+    if (!full) {
+        // Count the task before it becomes stealable, so the decrement of whoever takes it can not come first.
+        atomic_fetch_add_explicit(&pool->queued, 1, memory_order_relaxed);
+        self->tasks[self->tail++ % J_POOL_QUEUE_CAP] = task;
+    }
+    pthread_mutex_unlock(&self->lock);
 
-void j_rb_delete(void *tree, u32 descriptor) {
-    u32 y = descriptor;
-    u32 x;
-    J_RB_COLOR y_original_color = j_rb_color(tree, y);
-    if (j_rb_left(tree, descriptor).is_present == false) {
-        x = _j_rb_right(tree, descriptor);
-        _j_rb_transplant(tree, descriptor, x);
-    } else if (j_rb_right(tree, descriptor).is_present == false) {
-        x = _j_rb_left(tree, descriptor);
-        _j_rb_transplant(tree, descriptor, x);
-    } else {
-        y = _j_rb_right(tree, descriptor);
-        while (j_rb_left(tree, y).is_present) {
-            y = _j_rb_left(tree, y);
-        }
-        y_original_color = j_rb_color(tree, y);
-        x = _j_rb_right(tree, y);
-        if (_j_rb_parent(tree, y) == descriptor) {
-            _j_rb_parent(tree, x) = y;
-        } else {
-            _j_rb_transplant(tree, y, x);
-            _j_rb_right(tree, y) = _j_rb_right(tree, descriptor);
-            j_rb_parent(tree, _j_rb_right(tree, y)) = ((j_maybe(u32)) { .is_present = true, .value = y });
+    if (full) {
+        _j_pool_run(self, task);
+        return;
+    }
+    pthread_mutex_lock(&pool->sleep_lock);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+}
+
+void j_pool_wait(ThreadPool *pool, TaskGroup *group) {
+    PoolWorker *self = _j_pool_self(pool);
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        if (!_j_pool_try_run(self)) {
+            sched_yield();
         }
-        _j_rb_transplant(tree, descriptor, y);
-        j_rb_left(tree, y) = j_rb_left(tree, descriptor);
-        j_rb_parent(tree, _j_rb_left(tree, y)) = ((j_maybe(u32)) { .is_present = true, .value = y });
-        j_rb_color(tree, y) = j_rb_color(tree, descriptor);
     }
-    if (y_original_color == J_RB_BLACK) {
-        _j_rb_delete_fixup(tree, x);
+}
+
+typedef struct ParallelFor {
+    PoolTaskFunc func;
+    void * _Nullable ctx;
+    u64 grain;
+    TaskGroup group;
+} ParallelFor;
+
+static void _j_parallel_for_split(void *ctx, u64 begin, u64 end, PoolWorker *worker) {
+    ParallelFor *job = ctx;
+    while (end - begin > job->grain) {
+        u64 mid = begin + (end - begin) / 2;
+        j_pool_submit(worker->pool, &job->group, _j_parallel_for_split, job, mid, end);
+        end = mid;
     }
+    job->func(job->ctx, begin, end, worker);
 }
 
-void _j_rb_left_rotate(void *tree, u32 descriptor) {
-    // We know y is present;
-    j_maybe(u32) y = j_rb_right(tree, descriptor);
-    j_maybe(u32) yleft = j_rb_left(tree, y.value);
-    j_rb_right(tree, descriptor) = yleft;
+void j_parallel_for(ThreadPool *pool, u64 n, u64 grain, PoolTaskFunc func, void *ctx) {
+    if (n == 0) return;
+    if (grain == 0) {
+        grain = n / ((pool->worker_count + 1) * 8);
+        if (grain == 0) grain = 1;
+    }
+    ParallelFor job = { .func = func, .ctx = ctx, .grain = grain };
+    j_pool_submit(pool, &job.group, _j_parallel_for_split, &job, 0, n);
+    j_pool_wait(pool, &job.group);
+}
 
-    if_let(left, yleft, {
-        j_rb_parent(tree, left) = ((j_maybe(u32)) { .is_present = true, .value = descriptor});
-    })
-    j_rb_parent(tree, y.value) = j_rb_parent(tree, descriptor);
-    if (j_rb_parent(tree, descriptor).is_present == false) {
-        j_rb_root(tree) = y;
-    } else if (_j_rb_is_left_sibling(tree, descriptor)) {
-        j_rb_left(tree, j_rb_parent(tree, descriptor).value) = y;
+// MARK: - Bitset Implementation
+
+Bitset j_make_bitset(Arena *arena, u64 len) {
+    u64 count = j_bitset_word_count(len);
+    u64 *words = _j_alloc_aligned(arena, sizeof(u64) * count, _Alignof(u64));
+    memset(words, 0, sizeof(u64) * count);
+    return (Bitset) { .words = words, .len = len, .word_cap = count, .ranks = NULL };
+}
+
+void j_bitset_resize(Bitset *bs, Arena *arena, u64 new_len) {
+    u64 count = j_bitset_word_count(bs->len);
+    u64 new_count = j_bitset_word_count(new_len);
+    if (new_count > bs->word_cap) {
+        u64 new_cap = bs->word_cap * 2 > new_count ? bs->word_cap * 2 : new_count;
+        u64 *words = _j_alloc_aligned(arena, sizeof(u64) * new_cap, _Alignof(u64));
+        if (count > 0) memcpy(words, bs->words, sizeof(u64) * count);
+        memset(words + count, 0, sizeof(u64) * (new_cap - count));
+        if (bs->words != NULL) _j_free_aligned(arena, bs->words, sizeof(u64) * bs->word_cap, _Alignof(u64));
+        bs->words = words;
+        bs->word_cap = new_cap;
+    } else if (new_len < bs->len) {
+        // Keep the bits past the new length zero, so growing again reads them as cleared.
+        if (new_count < count) memset(bs->words + new_count, 0, sizeof(u64) * (count - new_count));
+        if (new_len % 64 != 0) bs->words[new_count - 1] &= (1ull << (new_len % 64)) - 1;
+    }
+    bs->len = new_len;
+    bs->ranks = NULL;
+}
+
+void j_bitset_push(Bitset *bs, Arena *arena, bool value) {
+    u64 i = bs->len;
+    j_bitset_resize(bs, arena, i + 1);
+    if (value) j_bitset_set(bs, i);
+}
+
+void j_bitset_fill(Bitset *bs, bool value) {
+    u64 count = j_bitset_word_count(bs->len);
+    memset(bs->words, value ? 0xff : 0, sizeof(u64) * count);
+    if (value && bs->len % 64 != 0) {
+        bs->words[count - 1] = (1ull << (bs->len % 64)) - 1;
+    }
+}
+
+#define _j_bitset_binary_op(dst, src, op) do { \
+    jassert((dst)->len == (src)->len, "Precondition: The bitsets must have the same length\n"); \
+    u64 *restrict j_bitset_out = (dst)->words; \
+    const u64 *restrict j_bitset_in = (src)->words; \
+    for (u64 i = 0, count = j_bitset_word_count((dst)->len); i < count; ++i) { \
+        j_bitset_out[i] op j_bitset_in[i]; \
+    } \
+} while(0)
+
+void j_bitset_and(Bitset *dst, const Bitset *src) { _j_bitset_binary_op(dst, src, &=); }
+void j_bitset_or(Bitset *dst, const Bitset *src) { _j_bitset_binary_op(dst, src, |=); }
+void j_bitset_xor(Bitset *dst, const Bitset *src) { _j_bitset_binary_op(dst, src, ^=); }
+
+static inline u64 _j_popcount_words(const u64 *words, u64 count) {
+    // Independent accumulators let the compiler keep several popcounts in flight, or vectorise the loop when the
+    // target has a vector popcount.
+    u64 c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    u64 i = 0;
+    for (; i + 4 <= count; i += 4) {
+        c0 += __builtin_popcountll(words[i]);
+        c1 += __builtin_popcountll(words[i + 1]);
+        c2 += __builtin_popcountll(words[i + 2]);
+        c3 += __builtin_popcountll(words[i + 3]);
+    }
+    for (; i < count; ++i) {
+        c0 += __builtin_popcountll(words[i]);
+    }
+    return c0 + c1 + c2 + c3;
+}
+
+u64 j_bitset_count(const Bitset *bs) {
+    return _j_popcount_words(bs->words, j_bitset_word_count(bs->len));
+}
+
+j_maybe(u64) j_bitset_next_set(const Bitset *bs, u64 from) {
+    if (from >= bs->len) return (j_maybe(u64)) NIL;
+    u64 index = from >> 6;
+    u64 word = bs->words[index] & (~0ull << (from & 63));
+    u64 count = j_bitset_word_count(bs->len);
+    while (word == 0) {
+        if (++index == count) return (j_maybe(u64)) NIL;
+        word = bs->words[index];
+    }
+    return (j_maybe(u64)) { .is_present = true, .value = index * 64 + __builtin_ctzll(word) };
+}
+
+void j_bitset_build_rank(Bitset *bs, Arena *arena) {
+    u64 count = j_bitset_word_count(bs->len);
+    u64 blocks = count / J_BITSET_RANK_BLOCK_WORDS + 1;
+    if (bs->ranks == NULL) {
+        bs->ranks = _j_alloc_aligned(arena, sizeof(u64) * blocks, _Alignof(u64));
+    }
+    u64 total = 0;
+    for (u64 block = 0; block < blocks; ++block) {
+        bs->ranks[block] = total;
+        u64 start = block * J_BITSET_RANK_BLOCK_WORDS;
+        u64 end = start + J_BITSET_RANK_BLOCK_WORDS < count ? start + J_BITSET_RANK_BLOCK_WORDS : count;
+        if (start < end) total += _j_popcount_words(bs->words + start, end - start);
+    }
+}
+
+u64 j_bitset_rank(const Bitset *bs, u64 i) {
+    jassert(bs->ranks != NULL, "Precondition: Call j_bitset_build_rank first\n");
+    jassert(i <= bs->len, "Precondition: The position must be at most the length\n");
+    u64 word = i >> 6;
+    u64 block = word / J_BITSET_RANK_BLOCK_WORDS;
+    u64 rank = bs->ranks[block] + _j_popcount_words(bs->words + block * J_BITSET_RANK_BLOCK_WORDS, word - block * J_BITSET_RANK_BLOCK_WORDS);
+    if (i & 63) {
+        rank += __builtin_popcountll(bs->words[word] & ((1ull << (i & 63)) - 1));
+    }
+    return rank;
+}
+
+j_maybe(u64) j_bitset_select(const Bitset *bs, u64 k) {
+    jassert(bs->ranks != NULL, "Precondition: Call j_bitset_build_rank first\n");
+    u64 count = j_bitset_word_count(bs->len);
+    u64 blocks = count / J_BITSET_RANK_BLOCK_WORDS + 1;
+    // Last block whose rank is at most k.
+    u64 lo = 0, hi = blocks;
+    while (hi - lo > 1) {
+        u64 mid = lo + (hi - lo) / 2;
+        if (bs->ranks[mid] <= k) lo = mid;
+        else hi = mid;
+    }
+    k -= bs->ranks[lo];
+    for (u64 index = lo * J_BITSET_RANK_BLOCK_WORDS; index < count; ++index) {
+        u64 word = bs->words[index];
+        u64 ones = __builtin_popcountll(word);
+        if (k < ones) {
+            for (; k > 0; --k) word &= word - 1;
+            return (j_maybe(u64)) { .is_present = true, .value = index * 64 + __builtin_ctzll(word) };
+        }
+        k -= ones;
+    }
+    return (j_maybe(u64)) NIL;
+}
+
+// MARK: - Slot Map Implementation
+
+void *_j_slot_reserve(void *map, Arena *arena, u64 elem_size) {
+    SlotMapHeader *header = map ? cast(SlotMapHeader *, map) - 1 : NULL;
+    if (header != NULL && header->len < header->cap) return map;
+
+    u32 cap = header ? header->cap * 2 : 16;
+    const u64 align = _Alignof(max_align_t);
+    SlotMapHeader *grown = _j_alloc_aligned(arena, sizeof(SlotMapHeader) + elem_size * cap, align);
+    *grown = (SlotMapHeader) {
+            .len = 0,
+            .cap = cap,
+            .slot_count = 0,
+            .free_head = J_SLOT_NONE,
+            .slots = _j_alloc_aligned(arena, sizeof(SlotEntry) * cap, align),
+            .dense_to_slot = _j_alloc_aligned(arena, sizeof(u32) * cap, align),
+    };
+    if (header != NULL) {
+        grown->len = header->len;
+        grown->slot_count = header->slot_count;
+        grown->free_head = header->free_head;
+        memcpy(grown + 1, map, elem_size * header->len);
+        memcpy(grown->slots, header->slots, sizeof(SlotEntry) * header->slot_count);
+        memcpy(grown->dense_to_slot, header->dense_to_slot, sizeof(u32) * header->len);
+        _j_free_aligned(arena, header->dense_to_slot, sizeof(u32) * header->cap, align);
+        _j_free_aligned(arena, header->slots, sizeof(SlotEntry) * header->cap, align);
+        _j_free_aligned(arena, header, sizeof(SlotMapHeader) + elem_size * header->cap, align);
+    }
+    return grown + 1;
+}
+
+SlotHandle _j_slot_push(SlotMapHeader *header) {
+    jassert(header->len < header->cap, "Precondition: The slot map must have room for the value\n");
+    u32 slot;
+    if (header->free_head != J_SLOT_NONE) {
+        slot = header->free_head;
+        header->free_head = header->slots[slot].dense;
     } else {
-        j_rb_right(tree, j_rb_parent(tree, descriptor).value) = y;
+        slot = header->slot_count++;
+        header->slots[slot].generation = 0;
     }
+    header->slots[slot].dense = header->len;
+    header->dense_to_slot[header->len] = slot;
+    header->len++;
+    return (SlotHandle) { .index = slot, .generation = header->slots[slot].generation };
+}
 
-    j_rb_left(tree, y.value) = ((j_maybe(u32)) { .value = descriptor, .is_present = true });
-    j_rb_parent(tree, descriptor) = y;
+bool _j_slot_erase(SlotMapHeader *header, void *values, u64 elem_size, SlotHandle handle) {
+    if (header == NULL || handle.index >= header->slot_count) return false;
+    SlotEntry *entry = &header->slots[handle.index];
+    if (entry->generation != handle.generation) return false;
+
+    u32 dense = entry->dense;
+    u32 last = header->len - 1;
+    if (dense != last) {
+        memcpy(cast(u8 *, values) + dense * elem_size, cast(u8 *, values) + last * elem_size, elem_size);
+        u32 moved_slot = header->dense_to_slot[last];
+        header->dense_to_slot[dense] = moved_slot;
+        header->slots[moved_slot].dense = dense;
+    }
+    header->len--;
+    entry->generation++;
+    entry->dense = header->free_head;
+    header->free_head = handle.index;
+    return true;
+}
+
+// MARK: - Mapped ArrayList Implementation
+
+/**
+ * @brief Maps file_bytes of the file behind one private page that holds the header, and returns the list pointer.
+ */
+static void *_j_al_map_view(i32 fd, u64 file_bytes, u64 elem_size, u32 flags) {
+    u64 page = cast(u64, sysconf(_SC_PAGESIZE));
+    u64 data_bytes = (file_bytes + page - 1) / page * page;
+    u8 *base = mmap(NULL, page + data_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    if (file_bytes > 0) {
+        i32 prot = flags & J_MAP_WRITABLE ? PROT_READ | PROT_WRITE : PROT_READ;
+        if (mmap(base + page, file_bytes, prot, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(base, page + data_bytes);
+            return NULL;
+        }
+    }
+    MappedListHeader *header = cast(MappedListHeader *, base + page) - 1;
+    *header = (MappedListHeader) {
+            .fd = fd,
+            .flags = flags,
+            .elem_size = elem_size,
+            .reserved = page + data_bytes,
+            .list = { .len = file_bytes / elem_size, .cap = file_bytes / elem_size },
+    };
+    return base + page;
+}
+
+static void _j_al_unmap_view(void *list) {
+    MappedListHeader *header = j_al_mapped_header(list);
+    u64 page = cast(u64, sysconf(_SC_PAGESIZE));
+    munmap(cast(u8 *, list) - page, header->reserved);
+}
+
+void *_j_al_map_file(const char *path, u64 elem_size, u32 flags) {
+    i32 open_flags = flags & J_MAP_WRITABLE ? O_RDWR : O_RDONLY;
+    if (flags & J_MAP_CREATE) open_flags |= O_CREAT;
+    i32 fd = open(path, open_flags, 0644);
+    if (fd < 0) return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return NULL;
+    }
+    u64 file_bytes = cast(u64, info.st_size) / elem_size * elem_size;
+    void *list = _j_al_map_view(fd, file_bytes, elem_size, flags);
+    if (list == NULL) close(fd);
+    return list;
+}
+
+bool _j_al_mapped_reserve(void **list, u64 capacity) {
+    MappedListHeader *header = j_al_mapped_header(*list);
+    jassert(header->flags & J_MAP_WRITABLE, "Precondition: The list must be mapped as writable\n");
+    if (capacity <= header->list.cap) return true;
+    if (ftruncate(header->fd, cast(off_t, capacity * header->elem_size)) != 0) return false;
+    void *grown = _j_al_map_view(header->fd, capacity * header->elem_size, header->elem_size, header->flags);
+    if (grown == NULL) return false;
+    j_al_header(grown)->len = header->list.len;
+    _j_al_unmap_view(*list);
+    *list = grown;
+    return true;
+}
+
+bool _j_al_mapped_sync(void *list) {
+    MappedListHeader *header = j_al_mapped_header(list);
+    u64 bytes = header->list.len * header->elem_size;
+    if (bytes > 0 && msync(list, bytes, MS_SYNC) != 0) return false;
+    if ((header->flags & J_MAP_WRITABLE) == 0) return true;
+    // The length only lives in the private header page, so the file size has to carry it.
+    if (ftruncate(header->fd, cast(off_t, bytes)) != 0 || fsync(header->fd) != 0) return false;
+    // The pages past the new end of file must not be written, so the list is full until it is grown again.
+    header->list.cap = header->list.len;
+    return true;
+}
+
+bool _j_al_unmap(void *list) {
+    MappedListHeader header = *j_al_mapped_header(list);
+    _j_al_unmap_view(list);
+    bool truncated = true;
+    if (header.flags & J_MAP_WRITABLE) {
+        truncated = ftruncate(header.fd, cast(off_t, header.list.len * header.elem_size)) == 0;
+    }
+    close(header.fd);
+    return truncated;
 }
 
-void _j_rb_right_rotate(void *tree, u32 descriptor) {
-    // We know y is present;
-    j_maybe(u32) y = j_rb_left(tree, descriptor);
-    j_maybe(u32) yright = j_rb_right(tree, y.value);
-    j_rb_left(tree, descriptor) = yright;
+// MARK: - String Interner Implementation
 
-    if_let(right, yright, {
-        j_rb_parent(tree, right) = ((j_maybe(u32)) { .is_present = true, .value = descriptor});
-    })
-    j_rb_parent(tree, y.value) = j_rb_parent(tree, descriptor);
-    if (j_rb_parent(tree, descriptor).is_present == false) {
-        j_rb_root(tree) = y;
-    } else if (_j_rb_is_right_sibling(tree, descriptor)) {
-        j_rb_right(tree, j_rb_parent(tree, descriptor).value) = y;
-    } else {
-        j_rb_left(tree, j_rb_parent(tree, descriptor).value) = y;
-    }
+#define J_INTERNER_INITIAL_SLOTS 64
 
-    j_rb_right(tree, y.value) = ((j_maybe(u32)) { .value = descriptor, .is_present = true });
-    j_rb_parent(tree, descriptor) = y;
+Interner j_make_interner(Arena *arena) {
+    return (Interner) { .arena = arena, .strings = EMPTY_ARRAY, .slots = NULL, .slot_cap = 0 };
 }
 
-void _j_rb_insert_fixup(void *tree, u32 descriptor) {
-    while (j_rb_parent(tree, descriptor).is_present && j_rb_color(tree, _j_rb_parent(tree, descriptor)) == J_RB_RED) {
-        j_maybe(u32) my;
-        if (_j_rb_parent(tree, descriptor) == _j_rb_left(tree, _j_rb_grandparent(tree, descriptor))) {
-            u32 y = _j_rb_right(tree, _j_rb_grandparent(tree, descriptor));
-            if (j_rb_color(tree, y) == J_RB_RED) {
-                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
-                j_rb_color(tree, y) = J_RB_BLACK;
-                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
-                descriptor = _j_rb_grandparent(tree, descriptor);
-            } else {
-                if (_j_rb_is_right_sibling(tree, descriptor)) {
-                    descriptor = _j_rb_parent(tree, descriptor);
-                    _j_rb_left_rotate(tree, descriptor);
-                }
-                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
-                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
-                _j_rb_right_rotate(tree, _j_rb_grandparent(tree, descriptor));
-            }
-        } else  {
-            u32 y = _j_rb_left(tree, _j_rb_grandparent(tree, descriptor));
-            if (j_rb_color(tree, y) == J_RB_RED) {
-                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
-                j_rb_color(tree, y) = J_RB_BLACK;
-                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
-                descriptor = _j_rb_grandparent(tree, descriptor);
-            } else {
-                if (_j_rb_is_left_sibling(tree, descriptor)) {
-                    descriptor = _j_rb_parent(tree, descriptor);
-                    _j_rb_right_rotate(tree, descriptor);
-                }
-                j_rb_color(tree, _j_rb_parent(tree, descriptor)) = J_RB_BLACK;
-                j_rb_color(tree, _j_rb_grandparent(tree, descriptor)) = J_RB_RED;
-                _j_rb_left_rotate(tree, _j_rb_grandparent(tree, descriptor));
-            }
-        }
+/**
+ * @brief Slot holding the string, or the empty slot where it belongs. Linear probing over a power of two table.
+ */
+static u32 _j_interner_probe(const Interner *interner, const Str str, u64 hash) {
+    u32 mask = interner->slot_cap - 1;
+    u32 slot = cast(u32, hash) & mask;
+    while (interner->slots[slot] != 0) {
+        IStr candidate = interner->strings[interner->slots[slot] - 1];
+        if (istr_hash(candidate) == hash && str_eq(candidate, str)) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
 
+static void _j_interner_grow(Interner *interner) {
+    u32 old_cap = interner->slot_cap;
+    u32 *old_slots = interner->slots;
+    interner->slot_cap = old_cap ? old_cap * 2 : J_INTERNER_INITIAL_SLOTS;
+    interner->slots = _j_alloc_aligned(interner->arena, sizeof(u32) * interner->slot_cap, _Alignof(u32));
+    memset(interner->slots, 0, sizeof(u32) * interner->slot_cap);
+    u32 mask = interner->slot_cap - 1;
+    for (u32 id = 0; id < j_al_len(interner->strings); ++id) {
+        u32 slot = cast(u32, istr_hash(interner->strings[id])) & mask;
+        while (interner->slots[slot] != 0) slot = (slot + 1) & mask;
+        interner->slots[slot] = id + 1;
+    }
+    if (old_slots != NULL) {
+        _j_free_aligned(interner->arena, old_slots, sizeof(u32) * old_cap, _Alignof(u32));
     }
-    j_rb_color(tree, j_rb_root(tree).value) = J_RB_BLACK;
 }
 
-void _j_rb_delete_fixup(void *tree, u32 descriptor) {
-    while (descriptor != j_rb_root(tree).value && j_rb_color(tree, descriptor) == J_RB_BLACK) {
-        j_maybe(u32) mparent = j_rb_parent(tree, descriptor);
-        if_let(parent, mparent, {
-            if (j_rb_left(tree, parent).is_present && descriptor == j_rb_left(tree, parent).value) {
-                j_maybe(u32) msibling = j_rb_right(tree, parent);
-                if_let(sibling, msibling, {
-                        if (j_rb_color(tree, sibling) == J_RB_RED) {
-                            j_rb_color(tree, sibling) = J_RB_BLACK;
-                            j_rb_color(tree, parent) = J_RB_RED;
-                            _j_rb_left_rotate(tree, parent);
-                            msibling = j_rb_right(tree, parent);
-                        }
-                        if_let(sibling, msibling, {
-                            if (j_rb_left(tree, sibling).is_present && j_rb_color(tree, j_rb_left(tree, sibling).value) == J_RB_BLACK &&
-                                j_rb_right(tree, sibling).is_present && j_rb_color(tree, j_rb_right(tree, sibling).value) == J_RB_BLACK) {
-                                j_rb_color(tree, sibling) = J_RB_RED;
-                                descriptor = parent;
-                            } else {
-                                if (j_rb_right(tree, sibling).is_present && j_rb_color(tree, j_rb_right(tree, sibling).value) == J_RB_BLACK) {
-                                    j_rb_color(tree, j_rb_left(tree, sibling).value) = J_RB_BLACK;
-                                    j_rb_color(tree, sibling) = J_RB_RED;
-                                    _j_rb_right_rotate(tree, sibling);
-                                    msibling = j_rb_right(tree, parent);
-                                }
-                                if_let(sibling, msibling, {
-                                        j_rb_color(tree, sibling) = j_rb_color(tree, parent);
-                                        j_rb_color(tree, parent) = J_RB_BLACK;
-                                        j_rb_color(tree, j_rb_right(tree, sibling).value) = J_RB_BLACK;
-                                        _j_rb_left_rotate(tree, parent);
-                                        descriptor = j_rb_root(tree).value;
-                                })
-                            }
-                        })
-                })
-            } else {
-                j_maybe(u32) msibling = j_rb_left(tree, parent);
-                if_let(sibling, msibling, {
-                        if (j_rb_color(tree, sibling) == J_RB_RED) {
-                            j_rb_color(tree, sibling) = J_RB_BLACK;
-                            j_rb_color(tree, parent) = J_RB_RED;
-                            _j_rb_right_rotate(tree, parent);
-                            msibling = j_rb_left(tree, parent);
-                        }
-                        if_let(sibling, msibling, {
-                            if (j_rb_right(tree, sibling).is_present && j_rb_color(tree, j_rb_right(tree, sibling).value) == J_RB_BLACK &&
-                                j_rb_left(tree, sibling).is_present && j_rb_color(tree, j_rb_right(tree, sibling).value) == J_RB_BLACK) {
-                                j_rb_color(tree, sibling) = J_RB_RED;
-                                descriptor = parent;
-                            } else {
-                                if (j_rb_left(tree, sibling).is_present && j_rb_color(tree, j_rb_left(tree, sibling).value) == J_RB_BLACK) {
-                                    j_rb_color(tree, j_rb_right(tree, sibling).value) = J_RB_BLACK;
-                                    j_rb_color(tree, sibling) = J_RB_RED;
-                                    _j_rb_left_rotate(tree, sibling);
-                                    msibling = j_rb_left(tree, parent);
-                                }
-                                if_let(sibling, msibling, {
-                                        j_rb_color(tree, sibling) = j_rb_color(tree, parent);
-                                        j_rb_color(tree, parent) = J_RB_BLACK;
-                                        j_rb_color(tree, j_rb_left(tree, sibling).value) = J_RB_BLACK;
-                                        _j_rb_right_rotate(tree, parent);
-                                        descriptor = j_rb_root(tree).value;
-                                })
-                            }
-                        })
-                })
-            }
-        })
+IStr j_intern(Interner *interner, const Str str) {
+    // Keep the load factor at or below one half.
+    if (2 * (j_al_len(interner->strings) + 1) > interner->slot_cap) {
+        _j_interner_grow(interner);
+    }
+    u64 hash = str_hash(str);
+    u32 slot = _j_interner_probe(interner, str, hash);
+    if (interner->slots[slot] != 0) {
+        return interner->strings[interner->slots[slot] - 1];
     }
-    j_rb_color(tree, descriptor) = J_RB_BLACK;
+
+    IStrHeader *header = _j_alloc_aligned(interner->arena, sizeof(IStrHeader) + str.len + 1, _Alignof(IStrHeader));
+    *header = (IStrHeader) { .hash = hash, .id = cast(u32, j_al_len(interner->strings)), .len = str.len };
+    char *chars = cast(char *, header + 1);
+    memcpy(chars, str.str, str.len);
+    chars[str.len] = '\0';
+
+    IStr istr = { .str = chars, .len = str.len };
+    j_al_append(interner->strings, interner->arena, istr);
+    interner->slots[slot] = header->id + 1;
+    return istr;
+}
+
+j_maybe(Str) j_interner_find(const Interner *interner, const Str str) {
+    if (interner->slot_cap == 0) return (j_maybe(Str)) NIL;
+    u32 slot = _j_interner_probe(interner, str, str_hash(str));
+    if (interner->slots[slot] == 0) return (j_maybe(Str)) NIL;
+    return (j_maybe(Str)) { .is_present = true, .value = interner->strings[interner->slots[slot] - 1] };
 }
 
 // MARK: - SubString implementation
 
+#define J_STR_FIND_HORSPOOL_MIN 64
+
+/**
+ * @brief Boyer-Moore-Horspool, for long needles where the shift table skips most of the haystack.
+ */
+static const char *_j_str_find_horspool(const char *hay, u64 n, const char *needle, u64 m) {
+    u64 shift[256];
+    for (u32 c = 0; c < 256; ++c) shift[c] = m;
+    for (u64 i = 0; i + 1 < m; ++i) shift[cast(u8, needle[i])] = m - 1 - i;
+    const char last = needle[m - 1];
+    for (u64 i = 0; i + m <= n; i += shift[cast(u8, hay[i + m - 1])]) {
+        if (hay[i + m - 1] == last && memcmp(hay + i, needle, m - 1) == 0) return hay + i;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the first occurrence of the needle in the haystack, or NULL.
+ * Precondition: The needle must not be empty, since an empty haystack may have a NULL pointer to return.
+ * Short needles compare the first and last needle byte against J_SIMD_WIDTH candidate positions at once and only
+ * memcmp the candidates where both match, which rejects almost every position in real text.
+ */
+static const char *_j_str_find(const char *hay, u64 n, const char *needle, u64 m) {
+    jassert(m > 0, "Precondition: The needle must not be empty\n");
+    if (m > n) return NULL;
+    if (m == 1) return memchr(hay, needle[0], n);
+    if (m >= J_STR_FIND_HORSPOOL_MIN) return _j_str_find_horspool(hay, n, needle, m);
+
+    u64 i = 0;
+#if J_SIMD_WIDTH
+    const JVec first = _j_vec_splat(needle[0]);
+    const JVec last = _j_vec_splat(needle[m - 1]);
+    for (; i + m - 1 + J_SIMD_WIDTH <= n; i += J_SIMD_WIDTH) {
+        JVec block_first = _j_vec_load(hay + i);
+        JVec block_last = _j_vec_load(hay + i + m - 1);
+        u64 mask = _j_vec_mask(_j_vec_and(_j_vec_eq(block_first, first), _j_vec_eq(block_last, last)));
+        while (mask != 0) {
+            u64 candidate = i + _j_mask_first(mask);
+            if (memcmp(hay + candidate + 1, needle + 1, m - 2) == 0) return hay + candidate;
+            mask = _j_mask_drop_first(mask);
+        }
+    }
+#endif
+    for (; i + m <= n; ++i) {
+        if (hay[i] == needle[0] && hay[i + m - 1] == needle[m - 1] && memcmp(hay + i + 1, needle + 1, m - 2) == 0) {
+            return hay + i;
+        }
+    }
+    return NULL;
+}
+
 SubStr j_ss_drop_first(SubStr ss) {
     assert(ss.str.len > 0);
     ss.str.str++;
@@ -849,29 +4414,77 @@ void j_ss_remove_first_n(SubStr *ss, u32 n) {
 
 
 Maybeu32 j_ss_first_index_of_c(SubStr ss, char c) {
-    u32 j_ss_index = 0;
-    while (ss.str.str[j_ss_index] != c) {
-        j_ss_index++;
-        if (ss.str.len == j_ss_index)
-            return (Maybeu32) { .is_present = false };
+    if (ss.str.len == 0)
+        return (Maybeu32) { .is_present = false };
+    const char *match = memchr(ss.str.str, c, ss.str.len);
+    if (match == NULL)
+        return (Maybeu32) { .is_present = false };
+    return (Maybeu32) { .is_present = true, .value = cast(u32, match - ss.str.str) };
+}
+
+#define J_SS_SET_SIMD_MAX 16
+
+/**
+ * @brief Index of the first character whose membership in set equals member, or len if there is none.
+ * Sets of up to J_SS_SET_SIMD_MAX characters are compared a vector at a time, larger sets use a lookup table.
+ */
+static u32 _j_ss_scan_set(const char *str, u32 len, Str set, bool member) {
+    if (set.len == 0) return member ? len : 0;
+    u32 i = 0;
+#if J_SIMD_WIDTH
+    if (set.len <= J_SS_SET_SIMD_MAX) {
+        JVec set_vecs[J_SS_SET_SIMD_MAX];
+        for (u32 k = 0; k < set.len; ++k) set_vecs[k] = _j_vec_splat(set.str[k]);
+        u64 flip = member ? 0 : J_SIMD_FULL_MASK;
+        for (; i + J_SIMD_WIDTH <= len; i += J_SIMD_WIDTH) {
+            JVec block = _j_vec_load(str + i);
+            JVec hits = _j_vec_eq(block, set_vecs[0]);
+            for (u32 k = 1; k < set.len; ++k) hits = _j_vec_or(hits, _j_vec_eq(block, set_vecs[k]));
+            u64 mask = _j_vec_mask(hits) ^ flip;
+            if (mask != 0) return i + _j_mask_first(mask);
+        }
+    }
+#endif
+    bool table[256] = { 0 };
+    for (u32 k = 0; k < set.len; ++k) table[cast(u8, set.str[k])] = true;
+    for (; i < len; ++i) {
+        if (table[cast(u8, str[i])] == member) return i;
     }
-    return (Maybeu32) { .is_present = true, .value = j_ss_index };
+    return len;
 }
 
-Maybeu32 j_ss_first_index_of_str(SubStr ss, Str needle) {
-    if (ss.str.len < needle.len || ss.str.len == 0)
+Maybeu32 j_ss_first_index_of_any(SubStr ss, Str set) {
+    u32 index = _j_ss_scan_set(ss.str.str, ss.str.len, set, true);
+    if (index == ss.str.len)
         return (Maybeu32) { .is_present = false };
-    u32 index = 0;
-    while (str_start_with(j_ss_prefix_through(ss, needle.len).str, needle) == false) {
-        index++;
-        ss.str.str++;
-        ss.str.len--;
-        if (ss.str.len < needle.len)
-            return (Maybeu32) { .is_present = false };
-    }
     return (Maybeu32) { .is_present = true, .value = index };
 }
 
+u32 j_ss_span(SubStr ss, Str set) {
+    return _j_ss_scan_set(ss.str.str, ss.str.len, set, false);
+}
+
+SubStr j_ss_prefix_while_in(SubStr ss, Str set) {
+    ss.str.len = j_ss_span(ss, set);
+    return ss;
+}
+
+void j_ss_remove_while_in(SubStr *ss, Str set) {
+    j_ss_remove_first_n(ss, j_ss_span(*ss, set));
+}
+
+Maybeu32 j_ss_first_index_of_str(SubStr ss, Str needle) {
+    // The empty needle is found at the start of every string, empty or not, like str_contains.
+    if (needle.len == 0)
+        return (Maybeu32) { .is_present = true, .value = 0 };
+    if (ss.str.len < needle.len)
+        return (Maybeu32) { .is_present = false };
+    const char *match = _j_str_find(ss.str.str, ss.str.len, needle.str, needle.len);
+    if (match == NULL)
+        return (Maybeu32) { .is_present = false };
+    return (Maybeu32) { .is_present = true, .value = cast(u32, match - ss.str.str) };
+}
+
 
 
 SubStr j_ss_prefix_up_to(SubStr ss, u32 n) {
@@ -887,21 +4500,1059 @@ SubStr j_ss_prefix_through(SubStr ss, u32 n) {
     return ss;
 }
 
-
-MaybeSubStr j_ss_split_on_first_str(SubStr *ss, Str seperator) {
-    Maybeu32 mindex = j_ss_first_index_of_str(*ss, seperator);
-    if (mindex.is_present == false)
-        return (MaybeSubStr) { .is_present = false };
-    u32 index = mindex.value;
-    SubStr line = j_ss_prefix_up_to(*ss, index + seperator.len);
-    j_ss_remove_first_n(ss, index + seperator.len);
-
-    return (MaybeSubStr) { .is_present = true, .value = line };
+
+MaybeSubStr j_ss_split_on_first_str(SubStr *ss, Str seperator) {
+    Maybeu32 mindex = j_ss_first_index_of_str(*ss, seperator);
+    if (mindex.is_present == false)
+        return (MaybeSubStr) { .is_present = false };
+    u32 index = mindex.value;
+    SubStr line = *ss;
+    line.str.len = index;
+    j_ss_remove_first_n(ss, index + seperator.len);
+
+    return (MaybeSubStr) { .is_present = true, .value = line };
+}
+
+void j_ss_trim_front_whitespace(SubStr *ss) {
+    j_ss_remove_while_in(ss, str_from_lit(" \n\r\t"));
+}
+// MARK: - Tokenizer Implementation
+
+/**
+ * @brief Classifies the block starting at block into a mask of delimiter and newline lanes, dropping the lanes before pos.
+ */
+static void _j_tok_load_block(Tokenizer *tok, u64 block) {
+    const char *str = tok->input.str.str;
+    u64 len = tok->input.str.len;
+    u64 mask = 0;
+#if J_SIMD_WIDTH
+    if (block + J_SIMD_WIDTH <= len) {
+        JVec bytes = _j_vec_load(str + block);
+        mask = _j_vec_mask(_j_vec_or(_j_vec_eq(bytes, _j_vec_splat(tok->delimiter)), _j_vec_eq(bytes, _j_vec_splat('\n'))));
+    } else
+#endif
+    {
+        for (u64 i = block; i < len && i < block + J_TOK_BLOCK; ++i) {
+            if (str[i] == tok->delimiter || str[i] == '\n') mask |= ((1ull << J_SIMD_MASK_BITS) - 1) << ((i - block) * J_SIMD_MASK_BITS);
+        }
+    }
+    if (tok->pos > block) {
+        u64 skipped = (tok->pos - block) * J_SIMD_MASK_BITS;
+        mask = skipped >= 64 ? 0 : mask & (~0ull << skipped);
+    }
+    tok->block = block;
+    tok->mask = mask;
+}
+
+static SubStr _j_tok_view(Tokenizer *tok, u64 begin, u64 end) {
+    SubStr view = tok->input;
+    view.str.str += begin;
+    view.str.len = cast(u32, end - begin);
+    return view;
+}
+
+Tokenizer j_tok_make(SubStr input, char delimiter) {
+    Tokenizer tok = { .input = input, .delimiter = delimiter, .at_line_end = true, .done = input.str.len == 0 };
+    _j_tok_load_block(&tok, 0);
+    return tok;
+}
+
+MaybeSubStr j_tok_next_field(Tokenizer *tok) {
+    if (tok->done) return (MaybeSubStr) { .is_present = false };
+    u64 len = tok->input.str.len;
+    while (tok->mask == 0) {
+        if (tok->block + J_TOK_BLOCK >= len) {
+            // The last field ends at the end of the input. It is empty if the input ends with a delimiter.
+            tok->done = true;
+            if (tok->pos == len && tok->at_line_end) return (MaybeSubStr) { .is_present = false };
+            tok->at_line_end = true;
+            SubStr field = _j_tok_view(tok, tok->pos, len);
+            tok->pos = len;
+            return (MaybeSubStr) { .is_present = true, .value = field };
+        }
+        _j_tok_load_block(tok, tok->block + J_TOK_BLOCK);
+    }
+    u64 end = tok->block + _j_mask_first(tok->mask);
+    tok->mask = _j_mask_drop_first(tok->mask);
+    tok->at_line_end = tok->input.str.str[end] == '\n';
+    u64 field_end = tok->at_line_end && end > tok->pos && tok->input.str.str[end - 1] == '\r' ? end - 1 : end;
+    SubStr field = _j_tok_view(tok, tok->pos, field_end);
+    tok->pos = end + 1;
+    if (tok->pos == len && tok->at_line_end) tok->done = true;
+    return (MaybeSubStr) { .is_present = true, .value = field };
+}
+
+MaybeSubStr j_tok_next_line(Tokenizer *tok) {
+    if (tok->done) return (MaybeSubStr) { .is_present = false };
+    u64 len = tok->input.str.len;
+    const char *str = tok->input.str.str;
+    const char *newline = memchr(str + tok->pos, '\n', len - tok->pos);
+    u64 end = newline ? cast(u64, newline - str) : len;
+    u64 line_end = end > tok->pos && str[end - 1] == '\r' ? end - 1 : end;
+    SubStr line = _j_tok_view(tok, tok->pos, line_end);
+    tok->pos = newline ? end + 1 : len;
+    tok->at_line_end = true;
+    tok->done = tok->pos == len;
+    _j_tok_load_block(tok, tok->pos - tok->pos % J_TOK_BLOCK);
+    return (MaybeSubStr) { .is_present = true, .value = line };
+}
+
+// MARK: - UTF-8 Implementation
+
+u32 j_utf8_seq_len(u8 lead) {
+    if (lead < 0x80) return 1;
+    if (lead < 0xC2) return 0;
+    if (lead < 0xE0) return 2;
+    if (lead < 0xF0) return 3;
+    if (lead < 0xF5) return 4;
+    return 0;
+}
+
+/**
+ * @brief Decodes the sequence at the start of s. Returns its length, or minus the length of the maximal invalid
+ * subpart (at least 1) when it is ill formed, in which case the code point is J_UTF8_REPLACEMENT.
+ */
+static inline i32 _j_utf8_decode(const u8 *s, u64 len, u32 *code_point) {
+    u8 lead = s[0];
+    if (lead < 0x80) {
+        *code_point = lead;
+        return 1;
+    }
+    u32 n = j_utf8_seq_len(lead);
+    if (n == 0) {
+        *code_point = J_UTF8_REPLACEMENT;
+        return -1;
+    }
+    // The second byte carries the overlong, surrogate and too large checks, the rest are plain continuations.
+    u8 low = lead == 0xE0 ? 0xA0 : lead == 0xF0 ? 0x90 : 0x80;
+    u8 high = lead == 0xED ? 0x9F : lead == 0xF4 ? 0x8F : 0xBF;
+    u32 c = lead & (0x7F >> n);
+    for (u32 i = 1; i < n; ++i) {
+        if (i >= len || s[i] < low || s[i] > high) {
+            *code_point = J_UTF8_REPLACEMENT;
+            return -cast(i32, i);
+        }
+        c = (c << 6) | (s[i] & 0x3F);
+        low = 0x80;
+        high = 0xBF;
+    }
+    *code_point = c;
+    return cast(i32, n);
+}
+
+static bool _j_utf8_valid_scalar(const u8 *s, u64 len) {
+    u64 i = 0;
+    while (i < len) {
+        if (i + 16 <= len) {
+            u64 a, b;
+            memcpy(&a, s + i, 8);
+            memcpy(&b, s + i + 8, 8);
+            if (((a | b) & 0x8080808080808080ull) == 0) {
+                i += 16;
+                continue;
+            }
+        }
+        u32 code_point;
+        i32 n = _j_utf8_decode(s + i, len - i, &code_point);
+        if (n < 0) return false;
+        i += cast(u64, n);
+    }
+    return true;
+}
+
+#if defined(__AVX2__) || defined(__SSSE3__) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define J_UTF8_LUT 1
+#if defined(__AVX2__)
+typedef __m256i JUtf8Vec;
+#define J_UTF8_WIDTH 32
+#define _j_u8_load(p) _mm256_loadu_si256(cast(const __m256i *, (p)))
+#define _j_u8_table(t) _mm256_broadcastsi128_si256(_mm_loadu_si128(cast(const __m128i *, (t))))
+#define _j_u8_lookup(table, index) _mm256_shuffle_epi8((table), (index))
+#define _j_u8_high_nibble(v) _mm256_and_si256(_mm256_srli_epi16((v), 4), _mm256_set1_epi8(0x0F))
+#define _j_u8_low_nibble(v) _mm256_and_si256((v), _mm256_set1_epi8(0x0F))
+#define _j_u8_prev(v, prev, n) _mm256_alignr_epi8((v), _mm256_permute2x128_si256((prev), (v), 0x21), 16 - (n))
+#define _j_u8_subs(a, b) _mm256_subs_epu8((a), (b))
+#define _j_u8_and(a, b) _mm256_and_si256((a), (b))
+#define _j_u8_or(a, b) _mm256_or_si256((a), (b))
+#define _j_u8_xor(a, b) _mm256_xor_si256((a), (b))
+#define _j_u8_splat(c) _mm256_set1_epi8(cast(char, (c)))
+#define _j_u8_zero() _mm256_setzero_si256()
+#define _j_u8_is_ascii(v) (_mm256_movemask_epi8(v) == 0)
+#define _j_u8_any(v) (!_mm256_testz_si256((v), (v)))
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+typedef __m128i JUtf8Vec;
+#define J_UTF8_WIDTH 16
+#define _j_u8_load(p) _mm_loadu_si128(cast(const __m128i *, (p)))
+#define _j_u8_table(t) _mm_loadu_si128(cast(const __m128i *, (t)))
+#define _j_u8_lookup(table, index) _mm_shuffle_epi8((table), (index))
+#define _j_u8_high_nibble(v) _mm_and_si128(_mm_srli_epi16((v), 4), _mm_set1_epi8(0x0F))
+#define _j_u8_low_nibble(v) _mm_and_si128((v), _mm_set1_epi8(0x0F))
+#define _j_u8_prev(v, prev, n) _mm_alignr_epi8((v), (prev), 16 - (n))
+#define _j_u8_subs(a, b) _mm_subs_epu8((a), (b))
+#define _j_u8_and(a, b) _mm_and_si128((a), (b))
+#define _j_u8_or(a, b) _mm_or_si128((a), (b))
+#define _j_u8_xor(a, b) _mm_xor_si128((a), (b))
+#define _j_u8_splat(c) _mm_set1_epi8(cast(char, (c)))
+#define _j_u8_zero() _mm_setzero_si128()
+#define _j_u8_is_ascii(v) (_mm_movemask_epi8(v) == 0)
+#define _j_u8_any(v) (_mm_movemask_epi8(_mm_cmpeq_epi8((v), _mm_setzero_si128())) != 0xFFFF)
+#else
+typedef uint8x16_t JUtf8Vec;
+#define J_UTF8_WIDTH 16
+#define _j_u8_load(p) vld1q_u8(cast(const u8 *, (p)))
+#define _j_u8_table(t) vld1q_u8(t)
+#define _j_u8_lookup(table, index) vqtbl1q_u8((table), (index))
+#define _j_u8_high_nibble(v) vshrq_n_u8((v), 4)
+#define _j_u8_low_nibble(v) vandq_u8((v), vdupq_n_u8(0x0F))
+#define _j_u8_prev(v, prev, n) vextq_u8((prev), (v), 16 - (n))
+#define _j_u8_subs(a, b) vqsubq_u8((a), (b))
+#define _j_u8_and(a, b) vandq_u8((a), (b))
+#define _j_u8_or(a, b) vorrq_u8((a), (b))
+#define _j_u8_xor(a, b) veorq_u8((a), (b))
+#define _j_u8_splat(c) vdupq_n_u8(cast(u8, (c)))
+#define _j_u8_zero() vdupq_n_u8(0)
+#define _j_u8_is_ascii(v) (vmaxvq_u8(v) < 0x80)
+#define _j_u8_any(v) (vmaxvq_u8(v) != 0)
+#endif
+
+// Error classes of a two byte window. A window is an error when a class is set in all three of its lookups.
+#define _J_UTF8_TOO_SHORT (1 << 0) // A lead byte not followed by a continuation.
+#define _J_UTF8_TOO_LONG (1 << 1) // An ASCII byte followed by a continuation.
+#define _J_UTF8_OVERLONG_3 (1 << 2)
+#define _J_UTF8_TOO_LARGE (1 << 3)
+#define _J_UTF8_SURROGATE (1 << 4)
+#define _J_UTF8_OVERLONG_2 (1 << 5)
+#define _J_UTF8_TOO_LARGE_1000 (1 << 6)
+#define _J_UTF8_OVERLONG_4 (1 << 6)
+#define _J_UTF8_TWO_CONTS (1 << 7) // A continuation following a continuation, checked against the lead below.
+#define _J_UTF8_CARRY (_J_UTF8_TOO_SHORT | _J_UTF8_TOO_LONG | _J_UTF8_TWO_CONTS)
+
+// Indexed by the high nibble of the first byte, the low nibble of the first byte and the high nibble of the second.
+static const u8 _j_utf8_byte_1_high[16] = {
+    _J_UTF8_TOO_LONG, _J_UTF8_TOO_LONG, _J_UTF8_TOO_LONG, _J_UTF8_TOO_LONG,
+    _J_UTF8_TOO_LONG, _J_UTF8_TOO_LONG, _J_UTF8_TOO_LONG, _J_UTF8_TOO_LONG,
+    _J_UTF8_TWO_CONTS, _J_UTF8_TWO_CONTS, _J_UTF8_TWO_CONTS, _J_UTF8_TWO_CONTS,
+    _J_UTF8_TOO_SHORT | _J_UTF8_OVERLONG_2,
+    _J_UTF8_TOO_SHORT,
+    _J_UTF8_TOO_SHORT | _J_UTF8_OVERLONG_3 | _J_UTF8_SURROGATE,
+    _J_UTF8_TOO_SHORT | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000 | _J_UTF8_OVERLONG_4,
+};
+static const u8 _j_utf8_byte_1_low[16] = {
+    _J_UTF8_CARRY | _J_UTF8_OVERLONG_3 | _J_UTF8_OVERLONG_2 | _J_UTF8_OVERLONG_4,
+    _J_UTF8_CARRY | _J_UTF8_OVERLONG_2,
+    _J_UTF8_CARRY,
+    _J_UTF8_CARRY,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000 | _J_UTF8_SURROGATE,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+    _J_UTF8_CARRY | _J_UTF8_TOO_LARGE | _J_UTF8_TOO_LARGE_1000,
+};
+static const u8 _j_utf8_byte_2_high[16] = {
+    _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT,
+    _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT,
+    _J_UTF8_TOO_LONG | _J_UTF8_OVERLONG_2 | _J_UTF8_TWO_CONTS | _J_UTF8_OVERLONG_3 | _J_UTF8_TOO_LARGE_1000 | _J_UTF8_OVERLONG_4,
+    _J_UTF8_TOO_LONG | _J_UTF8_OVERLONG_2 | _J_UTF8_TWO_CONTS | _J_UTF8_OVERLONG_3 | _J_UTF8_TOO_LARGE,
+    _J_UTF8_TOO_LONG | _J_UTF8_OVERLONG_2 | _J_UTF8_TWO_CONTS | _J_UTF8_SURROGATE | _J_UTF8_TOO_LARGE,
+    _J_UTF8_TOO_LONG | _J_UTF8_OVERLONG_2 | _J_UTF8_TWO_CONTS | _J_UTF8_SURROGATE | _J_UTF8_TOO_LARGE,
+    _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT, _J_UTF8_TOO_SHORT,
+};
+
+typedef struct Utf8Checker {
+    JUtf8Vec error;
+    JUtf8Vec prev_input;
+    JUtf8Vec prev_incomplete;
+    JUtf8Vec byte_1_high;
+    JUtf8Vec byte_1_low;
+    JUtf8Vec byte_2_high;
+    JUtf8Vec incomplete_max;
+} Utf8Checker;
+
+static inline void _j_utf8_check_block(Utf8Checker *checker, JUtf8Vec input) {
+    if (_j_u8_is_ascii(input)) {
+        // A sequence cut off at the end of the previous block can not be completed by ASCII.
+        checker->error = _j_u8_or(checker->error, checker->prev_incomplete);
+    } else {
+        JUtf8Vec prev1 = _j_u8_prev(input, checker->prev_input, 1);
+        JUtf8Vec special_cases = _j_u8_and(_j_u8_and(
+            _j_u8_lookup(checker->byte_1_high, _j_u8_high_nibble(prev1)),
+            _j_u8_lookup(checker->byte_1_low, _j_u8_low_nibble(prev1))),
+            _j_u8_lookup(checker->byte_2_high, _j_u8_high_nibble(input)));
+        // Bytes two and three after a three or four byte lead must be continuations, and nothing else may be.
+        JUtf8Vec prev2 = _j_u8_prev(input, checker->prev_input, 2);
+        JUtf8Vec prev3 = _j_u8_prev(input, checker->prev_input, 3);
+        JUtf8Vec must_be_continuation = _j_u8_and(_j_u8_or(_j_u8_subs(prev2, _j_u8_splat(0xE0 - 0x80)),
+                                                           _j_u8_subs(prev3, _j_u8_splat(0xF0 - 0x80))),
+                                                  _j_u8_splat(0x80));
+        checker->error = _j_u8_or(checker->error, _j_u8_xor(must_be_continuation, special_cases));
+        checker->prev_incomplete = _j_u8_subs(input, checker->incomplete_max);
+    }
+    checker->prev_input = input;
+}
+
+static bool _j_utf8_valid_lut(const u8 *s, u64 len) {
+    // Lanes are non zero after subtracting when one of the last three bytes starts a sequence longer than the rest.
+    u8 incomplete_max[J_UTF8_WIDTH];
+    memset(incomplete_max, 0xFF, sizeof(incomplete_max));
+    incomplete_max[J_UTF8_WIDTH - 3] = 0xF0 - 1;
+    incomplete_max[J_UTF8_WIDTH - 2] = 0xE0 - 1;
+    incomplete_max[J_UTF8_WIDTH - 1] = 0xC0 - 1;
+    Utf8Checker checker = {
+        .error = _j_u8_zero(),
+        .prev_input = _j_u8_zero(),
+        .prev_incomplete = _j_u8_zero(),
+        .byte_1_high = _j_u8_table(_j_utf8_byte_1_high),
+        .byte_1_low = _j_u8_table(_j_utf8_byte_1_low),
+        .byte_2_high = _j_u8_table(_j_utf8_byte_2_high),
+        .incomplete_max = _j_u8_load(incomplete_max),
+    };
+    u64 i = 0;
+    for (; i + J_UTF8_WIDTH <= len; i += J_UTF8_WIDTH) {
+        _j_utf8_check_block(&checker, _j_u8_load(s + i));
+    }
+    // The tail is padded with ASCII zeros, which also flushes a sequence left open by the last full block.
+    u8 tail[J_UTF8_WIDTH] = { 0 };
+    memcpy(tail, s + i, len - i);
+    _j_utf8_check_block(&checker, _j_u8_load(tail));
+    checker.error = _j_u8_or(checker.error, checker.prev_incomplete);
+    return !_j_u8_any(checker.error);
+}
+#endif
+
+bool str_utf8_valid(const Str str) {
+#if J_UTF8_LUT
+    return _j_utf8_valid_lut(cast(const u8 *, str.str), str.len);
+#else
+    return _j_utf8_valid_scalar(cast(const u8 *, str.str), str.len);
+#endif
+}
+
+u64 str_utf8_count(const Str str) {
+    const u8 *s = cast(const u8 *, str.str);
+    u64 len = str.len;
+    u64 continuations = 0;
+    u64 i = 0;
+    // Continuation bytes (10xxxxxx) are flagged with a 1 in their own byte lane and summed lane wise. A lane can
+    // count up to 255 words before the lanes are folded into the total.
+    while (i + 8 <= len) {
+        u64 lanes = 0;
+        for (u32 words = 0; words < 255 && i + 8 <= len; ++words, i += 8) {
+            u64 word;
+            memcpy(&word, s + i, 8);
+            lanes += ((word & ~(word << 1)) >> 7) & 0x0101010101010101ull;
+        }
+        lanes = (lanes & 0x00FF00FF00FF00FFull) + ((lanes >> 8) & 0x00FF00FF00FF00FFull);
+        continuations += (lanes * 0x0001000100010001ull) >> 48;
+    }
+    for (; i < len; ++i) {
+        continuations += (s[i] & 0xC0) == 0x80;
+    }
+    return len - continuations;
+}
+
+j_maybe(u32) j_utf8_next(Utf8Iter *it) {
+    if (it->pos >= it->input.str.len) return (j_maybe(u32)) { .is_present = false };
+    u32 code_point;
+    i32 n = _j_utf8_decode(cast(const u8 *, it->input.str.str) + it->pos, it->input.str.len - it->pos, &code_point);
+    it->pos += cast(u32, n < 0 ? -n : n);
+    return (j_maybe(u32)) { .is_present = true, .value = code_point };
+}
+
+// MARK: - Number Parsing Implementation
+
+static inline bool _j_is_eight_digits(u64 word) {
+    // Every byte is in 0x30..0x39 exactly when its high nibble is 3 before and after adding 6.
+    return ((word & 0xF0F0F0F0F0F0F0F0ull) | (((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+           0x3333333333333333ull;
+}
+
+/**
+ * @brief Converts eight ASCII digits, the first in the lowest byte, by combining neighbouring lanes: pairs of
+ * digits, then pairs of pairs, then the two halves.
+ */
+static inline u64 _j_parse_eight_digits(u64 word) {
+    word = (word & 0x0F0F0F0F0F0F0F0Full) * 2561 >> 8;
+    word = (word & 0x00FF00FF00FF00FFull) * 6553601 >> 16;
+    return (word & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32;
+}
+
+/**
+ * @brief Parses the digits in [i, len) of s. Returns false when a byte is not a digit, there are no digits, or
+ * the value does not fit in a u64.
+ */
+static bool _j_parse_u64_digits(const char *s, u32 i, u32 len, u64 *out) {
+    if (i == len) return false;
+    u64 value = 0;
+    // A run of up to 19 digits can not overflow, so those are read eight at a time without checks.
+    u32 safe_end = len - i > 19 ? i + 19 : len;
+    for (; i + 8 <= safe_end; i += 8) {
+        u64 word;
+        memcpy(&word, s + i, 8);
+        if (!_j_is_eight_digits(word)) return false;
+        value = value * 100000000 + _j_parse_eight_digits(word);
+    }
+    for (; i < len; ++i) {
+        u8 digit = cast(u8, s[i] - '0');
+        if (digit > 9) return false;
+        if (__builtin_mul_overflow(value, 10, &value) || __builtin_add_overflow(value, digit, &value)) return false;
+    }
+    *out = value;
+    return true;
+}
+
+j_maybe(u64) j_ss_parse_u64(SubStr ss) {
+    const char *s = ss.str.str;
+    u32 i = ss.str.len > 0 && s[0] == '+' ? 1 : 0;
+    u64 value;
+    if (!_j_parse_u64_digits(s, i, ss.str.len, &value)) return (j_maybe(u64)) { .is_present = false };
+    return (j_maybe(u64)) { .is_present = true, .value = value };
+}
+
+j_maybe(i64) j_ss_parse_i64(SubStr ss) {
+    const char *s = ss.str.str;
+    bool negative = ss.str.len > 0 && s[0] == '-';
+    u32 i = ss.str.len > 0 && (s[0] == '-' || s[0] == '+') ? 1 : 0;
+    u64 magnitude;
+    if (!_j_parse_u64_digits(s, i, ss.str.len, &magnitude)) return (j_maybe(i64)) { .is_present = false };
+    if (magnitude > (negative ? cast(u64, INT64_MAX) + 1 : cast(u64, INT64_MAX))) return (j_maybe(i64)) { .is_present = false };
+    // Negating in unsigned arithmetic keeps INT64_MIN representable.
+    i64 value = negative ? cast(i64, 0 - magnitude) : cast(i64, magnitude);
+    return (j_maybe(i64)) { .is_present = true, .value = value };
+}
+
+#define _J_F64_SMALLEST_POWER_OF_TEN (-342)
+#define _J_F64_LARGEST_POWER_OF_TEN 308
+
+/**
+ * @brief The 128 most significant bits of 5^q for q in [-342, 308], high word first. Negative powers are rounded
+ * up, positive ones truncated, as the Eisel-Lemire algorithm requires.
+ */
+static const u64 _j_pow5_128[2 * (_J_F64_LARGEST_POWER_OF_TEN - _J_F64_SMALLEST_POWER_OF_TEN + 1)] = {
+    0xeef453d6923bd65aull, 0x113faa2906a13b3full, 0x9558b4661b6565f8ull, 0x4ac7ca59a424c507ull,
+    0xbaaee17fa23ebf76ull, 0x5d79bcf00d2df649ull, 0xe95a99df8ace6f53ull, 0xf4d82c2c107973dcull,
+    0x91d8a02bb6c10594ull, 0x79071b9b8a4be869ull, 0xb64ec836a47146f9ull, 0x9748e2826cdee284ull,
+    0xe3e27a444d8d98b7ull, 0xfd1b1b2308169b25ull, 0x8e6d8c6ab0787f72ull, 0xfe30f0f5e50e20f7ull,
+    0xb208ef855c969f4full, 0xbdbd2d335e51a935ull, 0xde8b2b66b3bc4723ull, 0xad2c788035e61382ull,
+    0x8b16fb203055ac76ull, 0x4c3bcb5021afcc31ull, 0xaddcb9e83c6b1793ull, 0xdf4abe242a1bbf3dull,
+    0xd953e8624b85dd78ull, 0xd71d6dad34a2af0dull, 0x87d4713d6f33aa6bull, 0x8672648c40e5ad68ull,
+    0xa9c98d8ccb009506ull, 0x680efdaf511f18c2ull, 0xd43bf0effdc0ba48ull, 0x0212bd1b2566def2ull,
+    0x84a57695fe98746dull, 0x014bb630f7604b57ull, 0xa5ced43b7e3e9188ull, 0x419ea3bd35385e2dull,
+    0xcf42894a5dce35eaull, 0x52064cac828675b9ull, 0x818995ce7aa0e1b2ull, 0x7343efebd1940993ull,
+    0xa1ebfb4219491a1full, 0x1014ebe6c5f90bf8ull, 0xca66fa129f9b60a6ull, 0xd41a26e077774ef6ull,
+    0xfd00b897478238d0ull, 0x8920b098955522b4ull, 0x9e20735e8cb16382ull, 0x55b46e5f5d5535b0ull,
+    0xc5a890362fddbc62ull, 0xeb2189f734aa831dull, 0xf712b443bbd52b7bull, 0xa5e9ec7501d523e4ull,
+    0x9a6bb0aa55653b2dull, 0x47b233c92125366eull, 0xc1069cd4eabe89f8ull, 0x999ec0bb696e840aull,
+    0xf148440a256e2c76ull, 0xc00670ea43ca250dull, 0x96cd2a865764dbcaull, 0x380406926a5e5728ull,
+    0xbc807527ed3e12bcull, 0xc605083704f5ecf2ull, 0xeba09271e88d976bull, 0xf7864a44c633682eull,
+    0x93445b8731587ea3ull, 0x7ab3ee6afbe0211dull, 0xb8157268fdae9e4cull, 0x5960ea05bad82964ull,
+    0xe61acf033d1a45dfull, 0x6fb92487298e33bdull, 0x8fd0c16206306babull, 0xa5d3b6d479f8e056ull,
+    0xb3c4f1ba87bc8696ull, 0x8f48a4899877186cull, 0xe0b62e2929aba83cull, 0x331acdabfe94de87ull,
+    0x8c71dcd9ba0b4925ull, 0x9ff0c08b7f1d0b14ull, 0xaf8e5410288e1b6full, 0x07ecf0ae5ee44dd9ull,
+    0xdb71e91432b1a24aull, 0xc9e82cd9f69d6150ull, 0x892731ac9faf056eull, 0xbe311c083a225cd2ull,
+    0xab70fe17c79ac6caull, 0x6dbd630a48aaf406ull, 0xd64d3d9db981787dull, 0x092cbbccdad5b108ull,
+    0x85f0468293f0eb4eull, 0x25bbf56008c58ea5ull, 0xa76c582338ed2621ull, 0xaf2af2b80af6f24eull,
+    0xd1476e2c07286faaull, 0x1af5af660db4aee1ull, 0x82cca4db847945caull, 0x50d98d9fc890ed4dull,
+    0xa37fce126597973cull, 0xe50ff107bab528a0ull, 0xcc5fc196fefd7d0cull, 0x1e53ed49a96272c8ull,
+    0xff77b1fcbebcdc4full, 0x25e8e89c13bb0f7aull, 0x9faacf3df73609b1ull, 0x77b191618c54e9acull,
+    0xc795830d75038c1dull, 0xd59df5b9ef6a2417ull, 0xf97ae3d0d2446f25ull, 0x4b0573286b44ad1dull,
+    0x9becce62836ac577ull, 0x4ee367f9430aec32ull, 0xc2e801fb244576d5ull, 0x229c41f793cda73full,
+    0xf3a20279ed56d48aull, 0x6b43527578c1110full, 0x9845418c345644d6ull, 0x830a13896b78aaa9ull,
+    0xbe5691ef416bd60cull, 0x23cc986bc656d553ull, 0xedec366b11c6cb8full, 0x2cbfbe86b7ec8aa8ull,
+    0x94b3a202eb1c3f39ull, 0x7bf7d71432f3d6a9ull, 0xb9e08a83a5e34f07ull, 0xdaf5ccd93fb0cc53ull,
+    0xe858ad248f5c22c9ull, 0xd1b3400f8f9cff68ull, 0x91376c36d99995beull, 0x23100809b9c21fa1ull,
+    0xb58547448ffffb2dull, 0xabd40a0c2832a78aull, 0xe2e69915b3fff9f9ull, 0x16c90c8f323f516cull,
+    0x8dd01fad907ffc3bull, 0xae3da7d97f6792e3ull, 0xb1442798f49ffb4aull, 0x99cd11cfdf41779cull,
+    0xdd95317f31c7fa1dull, 0x40405643d711d583ull, 0x8a7d3eef7f1cfc52ull, 0x482835ea666b2572ull,
+    0xad1c8eab5ee43b66ull, 0xda3243650005eecfull, 0xd863b256369d4a40ull, 0x90bed43e40076a82ull,
+    0x873e4f75e2224e68ull, 0x5a7744a6e804a291ull, 0xa90de3535aaae202ull, 0x711515d0a205cb36ull,
+    0xd3515c2831559a83ull, 0x0d5a5b44ca873e03ull, 0x8412d9991ed58091ull, 0xe858790afe9486c2ull,
+    0xa5178fff668ae0b6ull, 0x626e974dbe39a872ull, 0xce5d73ff402d98e3ull, 0xfb0a3d212dc8128full,
+    0x80fa687f881c7f8eull, 0x7ce66634bc9d0b99ull, 0xa139029f6a239f72ull, 0x1c1fffc1ebc44e80ull,
+    0xc987434744ac874eull, 0xa327ffb266b56220ull, 0xfbe9141915d7a922ull, 0x4bf1ff9f0062baa8ull,
+    0x9d71ac8fada6c9b5ull, 0x6f773fc3603db4a9ull, 0xc4ce17b399107c22ull, 0xcb550fb4384d21d3ull,
+    0xf6019da07f549b2bull, 0x7e2a53a146606a48ull, 0x99c102844f94e0fbull, 0x2eda7444cbfc426dull,
+    0xc0314325637a1939ull, 0xfa911155fefb5308ull, 0xf03d93eebc589f88ull, 0x793555ab7eba27caull,
+    0x96267c7535b763b5ull, 0x4bc1558b2f3458deull, 0xbbb01b9283253ca2ull, 0x9eb1aaedfb016f16ull,
+    0xea9c227723ee8bcbull, 0x465e15a979c1cadcull, 0x92a1958a7675175full, 0x0bfacd89ec191ec9ull,
+    0xb749faed14125d36ull, 0xcef980ec671f667bull, 0xe51c79a85916f484ull, 0x82b7e12780e7401aull,
+    0x8f31cc0937ae58d2ull, 0xd1b2ecb8b0908810ull, 0xb2fe3f0b8599ef07ull, 0x861fa7e6dcb4aa15ull,
+    0xdfbdcece67006ac9ull, 0x67a791e093e1d49aull, 0x8bd6a141006042bdull, 0xe0c8bb2c5c6d24e0ull,
+    0xaecc49914078536dull, 0x58fae9f773886e18ull, 0xda7f5bf590966848ull, 0xaf39a475506a899eull,
+    0x888f99797a5e012dull, 0x6d8406c952429603ull, 0xaab37fd7d8f58178ull, 0xc8e5087ba6d33b83ull,
+    0xd5605fcdcf32e1d6ull, 0xfb1e4a9a90880a64ull, 0x855c3be0a17fcd26ull, 0x5cf2eea09a55067full,
+    0xa6b34ad8c9dfc06full, 0xf42faa48c0ea481eull, 0xd0601d8efc57b08bull, 0xf13b94daf124da26ull,
+    0x823c12795db6ce57ull, 0x76c53d08d6b70858ull, 0xa2cb1717b52481edull, 0x54768c4b0c64ca6eull,
+    0xcb7ddcdda26da268ull, 0xa9942f5dcf7dfd09ull, 0xfe5d54150b090b02ull, 0xd3f93b35435d7c4cull,
+    0x9efa548d26e5a6e1ull, 0xc47bc5014a1a6dafull, 0xc6b8e9b0709f109aull, 0x359ab6419ca1091bull,
+    0xf867241c8cc6d4c0ull, 0xc30163d203c94b62ull, 0x9b407691d7fc44f8ull, 0x79e0de63425dcf1dull,
+    0xc21094364dfb5636ull, 0x985915fc12f542e4ull, 0xf294b943e17a2bc4ull, 0x3e6f5b7b17b2939dull,
+    0x979cf3ca6cec5b5aull, 0xa705992ceecf9c42ull, 0xbd8430bd08277231ull, 0x50c6ff782a838353ull,
+    0xece53cec4a314ebdull, 0xa4f8bf5635246428ull, 0x940f4613ae5ed136ull, 0x871b7795e136be99ull,
+    0xb913179899f68584ull, 0x28e2557b59846e3full, 0xe757dd7ec07426e5ull, 0x331aeada2fe589cfull,
+    0x9096ea6f3848984full, 0x3ff0d2c85def7621ull, 0xb4bca50b065abe63ull, 0x0fed077a756b53a9ull,
+    0xe1ebce4dc7f16dfbull, 0xd3e8495912c62894ull, 0x8d3360f09cf6e4bdull, 0x64712dd7abbbd95cull,
+    0xb080392cc4349decull, 0xbd8d794d96aacfb3ull, 0xdca04777f541c567ull, 0xecf0d7a0fc5583a0ull,
+    0x89e42caaf9491b60ull, 0xf41686c49db57244ull, 0xac5d37d5b79b6239ull, 0x311c2875c522ced5ull,
+    0xd77485cb25823ac7ull, 0x7d633293366b828bull, 0x86a8d39ef77164bcull, 0xae5dff9c02033197ull,
+    0xa8530886b54dbdebull, 0xd9f57f830283fdfcull, 0xd267caa862a12d66ull, 0xd072df63c324fd7bull,
+    0x8380dea93da4bc60ull, 0x4247cb9e59f71e6dull, 0xa46116538d0deb78ull, 0x52d9be85f074e608ull,
+    0xcd795be870516656ull, 0x67902e276c921f8bull, 0x806bd9714632dff6ull, 0x00ba1cd8a3db53b6ull,
+    0xa086cfcd97bf97f3ull, 0x80e8a40eccd228a4ull, 0xc8a883c0fdaf7df0ull, 0x6122cd128006b2cdull,
+    0xfad2a4b13d1b5d6cull, 0x796b805720085f81ull, 0x9cc3a6eec6311a63ull, 0xcbe3303674053bb0ull,
+    0xc3f490aa77bd60fcull, 0xbedbfc4411068a9cull, 0xf4f1b4d515acb93bull, 0xee92fb5515482d44ull,
+    0x991711052d8bf3c5ull, 0x751bdd152d4d1c4aull, 0xbf5cd54678eef0b6ull, 0xd262d45a78a0635dull,
+    0xef340a98172aace4ull, 0x86fb897116c87c34ull, 0x9580869f0e7aac0eull, 0xd45d35e6ae3d4da0ull,
+    0xbae0a846d2195712ull, 0x8974836059cca109ull, 0xe998d258869facd7ull, 0x2bd1a438703fc94bull,
+    0x91ff83775423cc06ull, 0x7b6306a34627ddcfull, 0xb67f6455292cbf08ull, 0x1a3bc84c17b1d542ull,
+    0xe41f3d6a7377eecaull, 0x20caba5f1d9e4a93ull, 0x8e938662882af53eull, 0x547eb47b7282ee9cull,
+    0xb23867fb2a35b28dull, 0xe99e619a4f23aa43ull, 0xdec681f9f4c31f31ull, 0x6405fa00e2ec94d4ull,
+    0x8b3c113c38f9f37eull, 0xde83bc408dd3dd04ull, 0xae0b158b4738705eull, 0x9624ab50b148d445ull,
+    0xd98ddaee19068c76ull, 0x3badd624dd9b0957ull, 0x87f8a8d4cfa417c9ull, 0xe54ca5d70a80e5d6ull,
+    0xa9f6d30a038d1dbcull, 0x5e9fcf4ccd211f4cull, 0xd47487cc8470652bull, 0x7647c3200069671full,
+    0x84c8d4dfd2c63f3bull, 0x29ecd9f40041e073ull, 0xa5fb0a17c777cf09ull, 0xf468107100525890ull,
+    0xcf79cc9db955c2ccull, 0x7182148d4066eeb4ull, 0x81ac1fe293d599bfull, 0xc6f14cd848405530ull,
+    0xa21727db38cb002full, 0xb8ada00e5a506a7cull, 0xca9cf1d206fdc03bull, 0xa6d90811f0e4851cull,
+    0xfd442e4688bd304aull, 0x908f4a166d1da663ull, 0x9e4a9cec15763e2eull, 0x9a598e4e043287feull,
+    0xc5dd44271ad3cdbaull, 0x40eff1e1853f29fdull, 0xf7549530e188c128ull, 0xd12bee59e68ef47cull,
+    0x9a94dd3e8cf578b9ull, 0x82bb74f8301958ceull, 0xc13a148e3032d6e7ull, 0xe36a52363c1faf01ull,
+    0xf18899b1bc3f8ca1ull, 0xdc44e6c3cb279ac1ull, 0x96f5600f15a7b7e5ull, 0x29ab103a5ef8c0b9ull,
+    0xbcb2b812db11a5deull, 0x7415d448f6b6f0e7ull, 0xebdf661791d60f56ull, 0x111b495b3464ad21ull,
+    0x936b9fcebb25c995ull, 0xcab10dd900beec34ull, 0xb84687c269ef3bfbull, 0x3d5d514f40eea742ull,
+    0xe65829b3046b0afaull, 0x0cb4a5a3112a5112ull, 0x8ff71a0fe2c2e6dcull, 0x47f0e785eaba72abull,
+    0xb3f4e093db73a093ull, 0x59ed216765690f56ull, 0xe0f218b8d25088b8ull, 0x306869c13ec3532cull,
+    0x8c974f7383725573ull, 0x1e414218c73a13fbull, 0xafbd2350644eeacfull, 0xe5d1929ef90898faull,
+    0xdbac6c247d62a583ull, 0xdf45f746b74abf39ull, 0x894bc396ce5da772ull, 0x6b8bba8c328eb783ull,
+    0xab9eb47c81f5114full, 0x066ea92f3f326564ull, 0xd686619ba27255a2ull, 0xc80a537b0efefebdull,
+    0x8613fd0145877585ull, 0xbd06742ce95f5f36ull, 0xa798fc4196e952e7ull, 0x2c48113823b73704ull,
+    0xd17f3b51fca3a7a0ull, 0xf75a15862ca504c5ull, 0x82ef85133de648c4ull, 0x9a984d73dbe722fbull,
+    0xa3ab66580d5fdaf5ull, 0xc13e60d0d2e0ebbaull, 0xcc963fee10b7d1b3ull, 0x318df905079926a8ull,
+    0xffbbcfe994e5c61full, 0xfdf17746497f7052ull, 0x9fd561f1fd0f9bd3ull, 0xfeb6ea8bedefa633ull,
+    0xc7caba6e7c5382c8ull, 0xfe64a52ee96b8fc0ull, 0xf9bd690a1b68637bull, 0x3dfdce7aa3c673b0ull,
+    0x9c1661a651213e2dull, 0x06bea10ca65c084eull, 0xc31bfa0fe5698db8ull, 0x486e494fcff30a62ull,
+    0xf3e2f893dec3f126ull, 0x5a89dba3c3efccfaull, 0x986ddb5c6b3a76b7ull, 0xf89629465a75e01cull,
+    0xbe89523386091465ull, 0xf6bbb397f1135823ull, 0xee2ba6c0678b597full, 0x746aa07ded582e2cull,
+    0x94db483840b717efull, 0xa8c2a44eb4571cdcull, 0xba121a4650e4ddebull, 0x92f34d62616ce413ull,
+    0xe896a0d7e51e1566ull, 0x77b020baf9c81d17ull, 0x915e2486ef32cd60ull, 0x0ace1474dc1d122eull,
+    0xb5b5ada8aaff80b8ull, 0x0d819992132456baull, 0xe3231912d5bf60e6ull, 0x10e1fff697ed6c69ull,
+    0x8df5efabc5979c8full, 0xca8d3ffa1ef463c1ull, 0xb1736b96b6fd83b3ull, 0xbd308ff8a6b17cb2ull,
+    0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull, 0x8aa22c0dbef60ee4ull, 0x6bcdf07a423aa96bull,
+    0xad4ab7112eb3929dull, 0x86c16c98d2c953c6ull, 0xd89d64d57a607744ull, 0xe871c7bf077ba8b7ull,
+    0x87625f056c7c4a8bull, 0x11471cd764ad4972ull, 0xa93af6c6c79b5d2dull, 0xd598e40d3dd89bcfull,
+    0xd389b47879823479ull, 0x4aff1d108d4ec2c3ull, 0x843610cb4bf160cbull, 0xcedf722a585139baull,
+    0xa54394fe1eedb8feull, 0xc2974eb4ee658828ull, 0xce947a3da6a9273eull, 0x733d226229feea32ull,
+    0x811ccc668829b887ull, 0x0806357d5a3f525full, 0xa163ff802a3426a8ull, 0xca07c2dcb0cf26f7ull,
+    0xc9bcff6034c13052ull, 0xfc89b393dd02f0b5ull, 0xfc2c3f3841f17c67ull, 0xbbac2078d443ace2ull,
+    0x9d9ba7832936edc0ull, 0xd54b944b84aa4c0dull, 0xc5029163f384a931ull, 0x0a9e795e65d4df11ull,
+    0xf64335bcf065d37dull, 0x4d4617b5ff4a16d5ull, 0x99ea0196163fa42eull, 0x504bced1bf8e4e45ull,
+    0xc06481fb9bcf8d39ull, 0xe45ec2862f71e1d6ull, 0xf07da27a82c37088ull, 0x5d767327bb4e5a4cull,
+    0x964e858c91ba2655ull, 0x3a6a07f8d510f86full, 0xbbe226efb628afeaull, 0x890489f70a55368bull,
+    0xeadab0aba3b2dbe5ull, 0x2b45ac74ccea842eull, 0x92c8ae6b464fc96full, 0x3b0b8bc90012929dull,
+    0xb77ada0617e3bbcbull, 0x09ce6ebb40173744ull, 0xe55990879ddcaabdull, 0xcc420a6a101d0515ull,
+    0x8f57fa54c2a9eab6ull, 0x9fa946824a12232dull, 0xb32df8e9f3546564ull, 0x47939822dc96abf9ull,
+    0xdff9772470297ebdull, 0x59787e2b93bc56f7ull, 0x8bfbea76c619ef36ull, 0x57eb4edb3c55b65aull,
+    0xaefae51477a06b03ull, 0xede622920b6b23f1ull, 0xdab99e59958885c4ull, 0xe95fab368e45ecedull,
+    0x88b402f7fd75539bull, 0x11dbcb0218ebb414ull, 0xaae103b5fcd2a881ull, 0xd652bdc29f26a119ull,
+    0xd59944a37c0752a2ull, 0x4be76d3346f0495full, 0x857fcae62d8493a5ull, 0x6f70a4400c562ddbull,
+    0xa6dfbd9fb8e5b88eull, 0xcb4ccd500f6bb952ull, 0xd097ad07a71f26b2ull, 0x7e2000a41346a7a7ull,
+    0x825ecc24c873782full, 0x8ed400668c0c28c8ull, 0xa2f67f2dfa90563bull, 0x728900802f0f32faull,
+    0xcbb41ef979346bcaull, 0x4f2b40a03ad2ffb9ull, 0xfea126b7d78186bcull, 0xe2f610c84987bfa8ull,
+    0x9f24b832e6b0f436ull, 0x0dd9ca7d2df4d7c9ull, 0xc6ede63fa05d3143ull, 0x91503d1c79720dbbull,
+    0xf8a95fcf88747d94ull, 0x75a44c6397ce912aull, 0x9b69dbe1b548ce7cull, 0xc986afbe3ee11abaull,
+    0xc24452da229b021bull, 0xfbe85badce996168ull, 0xf2d56790ab41c2a2ull, 0xfae27299423fb9c3ull,
+    0x97c560ba6b0919a5ull, 0xdccd879fc967d41aull, 0xbdb6b8e905cb600full, 0x5400e987bbc1c920ull,
+    0xed246723473e3813ull, 0x290123e9aab23b68ull, 0x9436c0760c86e30bull, 0xf9a0b6720aaf6521ull,
+    0xb94470938fa89bceull, 0xf808e40e8d5b3e69ull, 0xe7958cb87392c2c2ull, 0xb60b1d1230b20e04ull,
+    0x90bd77f3483bb9b9ull, 0xb1c6f22b5e6f48c2ull, 0xb4ecd5f01a4aa828ull, 0x1e38aeb6360b1af3ull,
+    0xe2280b6c20dd5232ull, 0x25c6da63c38de1b0ull, 0x8d590723948a535full, 0x579c487e5a38ad0eull,
+    0xb0af48ec79ace837ull, 0x2d835a9df0c6d851ull, 0xdcdb1b2798182244ull, 0xf8e431456cf88e65ull,
+    0x8a08f0f8bf0f156bull, 0x1b8e9ecb641b58ffull, 0xac8b2d36eed2dac5ull, 0xe272467e3d222f3full,
+    0xd7adf884aa879177ull, 0x5b0ed81dcc6abb0full, 0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull,
+    0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull, 0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull,
+    0x83a3eeeef9153e89ull, 0x1953cf68300424acull, 0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull,
+    0xcdb02555653131b6ull, 0x3792f412cb06794dull, 0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull,
+    0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull, 0xc8de047564d20a8bull, 0xf245825a5a445275ull,
+    0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull, 0x9ced737bb6c4183dull, 0x55464dd69685606bull,
+    0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull, 0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull,
+    0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull, 0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull,
+    0xef73d256a5c0f77cull, 0x963e66858f6d4440ull, 0x95a8637627989aadull, 0xdde7001379a44aa8ull,
+    0xbb127c53b17ec159ull, 0x5560c018580d5d52ull, 0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull,
+    0x9226712162ab070dull, 0xcab3961304ca70e8ull, 0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull,
+    0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull, 0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull,
+    0xb267ed1940f1c61cull, 0x55f038b237591ed3ull, 0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull,
+    0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull, 0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull,
+    0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull, 0x881cea14545c7575ull, 0x7e50d64177da2e54ull,
+    0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull, 0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull,
+    0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull, 0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull,
+    0xcfb11ead453994baull, 0x67de18eda5814af2ull, 0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull,
+    0xa2425ff75e14fc31ull, 0xa1258379a94d028dull, 0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull,
+    0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull, 0x9e74d1b791e07e48ull, 0x775ea264cf55347eull,
+    0xc612062576589ddaull, 0x95364afe032a819eull, 0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull,
+    0x9abe14cd44753b52ull, 0xc4926a9672793543ull, 0xc16d9a0095928a27ull, 0x75b7053c0f178294ull,
+    0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull, 0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull,
+    0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull, 0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull,
+    0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull, 0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull,
+    0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull, 0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull,
+    0xb424dc35095cd80full, 0x538484c19ef38c95ull, 0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull,
+    0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull, 0xafebff0bcb24aafeull, 0xf78f69a51539d749ull,
+    0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull, 0x89705f4136b4a597ull, 0x31680a88f8953031ull,
+    0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull, 0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull,
+    0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull, 0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull,
+    0xd1b71758e219652bull, 0xd3c36113404ea4a9ull, 0x83126e978d4fdf3bull, 0x645a1cac083126eaull,
+    0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull, 0xccccccccccccccccull, 0xcccccccccccccccdull,
+    0x8000000000000000ull, 0x0000000000000000ull, 0xa000000000000000ull, 0x0000000000000000ull,
+    0xc800000000000000ull, 0x0000000000000000ull, 0xfa00000000000000ull, 0x0000000000000000ull,
+    0x9c40000000000000ull, 0x0000000000000000ull, 0xc350000000000000ull, 0x0000000000000000ull,
+    0xf424000000000000ull, 0x0000000000000000ull, 0x9896800000000000ull, 0x0000000000000000ull,
+    0xbebc200000000000ull, 0x0000000000000000ull, 0xee6b280000000000ull, 0x0000000000000000ull,
+    0x9502f90000000000ull, 0x0000000000000000ull, 0xba43b74000000000ull, 0x0000000000000000ull,
+    0xe8d4a51000000000ull, 0x0000000000000000ull, 0x9184e72a00000000ull, 0x0000000000000000ull,
+    0xb5e620f480000000ull, 0x0000000000000000ull, 0xe35fa931a0000000ull, 0x0000000000000000ull,
+    0x8e1bc9bf04000000ull, 0x0000000000000000ull, 0xb1a2bc2ec5000000ull, 0x0000000000000000ull,
+    0xde0b6b3a76400000ull, 0x0000000000000000ull, 0x8ac7230489e80000ull, 0x0000000000000000ull,
+    0xad78ebc5ac620000ull, 0x0000000000000000ull, 0xd8d726b7177a8000ull, 0x0000000000000000ull,
+    0x878678326eac9000ull, 0x0000000000000000ull, 0xa968163f0a57b400ull, 0x0000000000000000ull,
+    0xd3c21bcecceda100ull, 0x0000000000000000ull, 0x84595161401484a0ull, 0x0000000000000000ull,
+    0xa56fa5b99019a5c8ull, 0x0000000000000000ull, 0xcecb8f27f4200f3aull, 0x0000000000000000ull,
+    0x813f3978f8940984ull, 0x4000000000000000ull, 0xa18f07d736b90be5ull, 0x5000000000000000ull,
+    0xc9f2c9cd04674edeull, 0xa400000000000000ull, 0xfc6f7c4045812296ull, 0x4d00000000000000ull,
+    0x9dc5ada82b70b59dull, 0xf020000000000000ull, 0xc5371912364ce305ull, 0x6c28000000000000ull,
+    0xf684df56c3e01bc6ull, 0xc732000000000000ull, 0x9a130b963a6c115cull, 0x3c7f400000000000ull,
+    0xc097ce7bc90715b3ull, 0x4b9f100000000000ull, 0xf0bdc21abb48db20ull, 0x1e86d40000000000ull,
+    0x96769950b50d88f4ull, 0x1314448000000000ull, 0xbc143fa4e250eb31ull, 0x17d955a000000000ull,
+    0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull, 0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull,
+    0xb7abc627050305adull, 0xf14a3d9e40000000ull, 0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull,
+    0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull, 0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull,
+    0xe0352f62a19e306eull, 0xd50b2037ad200000ull, 0x8c213d9da502de45ull, 0x4526f422cc340000ull,
+    0xaf298d050e4395d6ull, 0x9670b12b7f410000ull, 0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull,
+    0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull, 0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull,
+    0xd5d238a4abe98068ull, 0x72a4904598d6d880ull, 0x85a36366eb71f041ull, 0x47a6da2b7f864750ull,
+    0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull, 0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull,
+    0x82818f1281ed449full, 0xbff8f10e7a8921a4ull, 0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull,
+    0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull, 0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull,
+    0x9f4f2726179a2245ull, 0x01d762422c946590ull, 0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull,
+    0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull, 0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full,
+    0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull, 0xf316271c7fc3908aull, 0x8bef464e3945ef7aull,
+    0x97edd871cfda3a56ull, 0x97758bf0e3cbb5acull, 0xbde94e8e43d0c8ecull, 0x3d52eeed1cbea317ull,
+    0xed63a231d4c4fb27ull, 0x4ca7aaa863ee4bddull, 0x945e455f24fb1cf8ull, 0x8fe8caa93e74ef6aull,
+    0xb975d6b6ee39e436ull, 0xb3e2fd538e122b44ull, 0xe7d34c64a9c85d44ull, 0x60dbbca87196b616ull,
+    0x90e40fbeea1d3a4aull, 0xbc8955e946fe31cdull, 0xb51d13aea4a488ddull, 0x6babab6398bdbe41ull,
+    0xe264589a4dcdab14ull, 0xc696963c7eed2dd1ull, 0x8d7eb76070a08aecull, 0xfc1e1de5cf543ca2ull,
+    0xb0de65388cc8ada8ull, 0x3b25a55f43294bcbull, 0xdd15fe86affad912ull, 0x49ef0eb713f39ebeull,
+    0x8a2dbf142dfcc7abull, 0x6e3569326c784337ull, 0xacb92ed9397bf996ull, 0x49c2c37f07965404ull,
+    0xd7e77a8f87daf7fbull, 0xdc33745ec97be906ull, 0x86f0ac99b4e8dafdull, 0x69a028bb3ded71a3ull,
+    0xa8acd7c0222311bcull, 0xc40832ea0d68ce0cull, 0xd2d80db02aabd62bull, 0xf50a3fa490c30190ull,
+    0x83c7088e1aab65dbull, 0x792667c6da79e0faull, 0xa4b8cab1a1563f52ull, 0x577001b891185938ull,
+    0xcde6fd5e09abcf26ull, 0xed4c0226b55e6f86ull, 0x80b05e5ac60b6178ull, 0x544f8158315b05b4ull,
+    0xa0dc75f1778e39d6ull, 0x696361ae3db1c721ull, 0xc913936dd571c84cull, 0x03bc3a19cd1e38e9ull,
+    0xfb5878494ace3a5full, 0x04ab48a04065c723ull, 0x9d174b2dcec0e47bull, 0x62eb0d64283f9c76ull,
+    0xc45d1df942711d9aull, 0x3ba5d0bd324f8394ull, 0xf5746577930d6500ull, 0xca8f44ec7ee36479ull,
+    0x9968bf6abbe85f20ull, 0x7e998b13cf4e1ecbull, 0xbfc2ef456ae276e8ull, 0x9e3fedd8c321a67eull,
+    0xefb3ab16c59b14a2ull, 0xc5cfe94ef3ea101eull, 0x95d04aee3b80ece5ull, 0xbba1f1d158724a12ull,
+    0xbb445da9ca61281full, 0x2a8a6e45ae8edc97ull, 0xea1575143cf97226ull, 0xf52d09d71a3293bdull,
+    0x924d692ca61be758ull, 0x593c2626705f9c56ull, 0xb6e0c377cfa2e12eull, 0x6f8b2fb00c77836cull,
+    0xe498f455c38b997aull, 0x0b6dfb9c0f956447ull, 0x8edf98b59a373fecull, 0x4724bd4189bd5eacull,
+    0xb2977ee300c50fe7ull, 0x58edec91ec2cb657ull, 0xdf3d5e9bc0f653e1ull, 0x2f2967b66737e3edull,
+    0x8b865b215899f46cull, 0xbd79e0d20082ee74ull, 0xae67f1e9aec07187ull, 0xecd8590680a3aa11ull,
+    0xda01ee641a708de9ull, 0xe80e6f4820cc9495ull, 0x884134fe908658b2ull, 0x3109058d147fdcddull,
+    0xaa51823e34a7eedeull, 0xbd4b46f0599fd415ull, 0xd4e5e2cdc1d1ea96ull, 0x6c9e18ac7007c91aull,
+    0x850fadc09923329eull, 0x03e2cf6bc604ddb0ull, 0xa6539930bf6bff45ull, 0x84db8346b786151cull,
+    0xcfe87f7cef46ff16ull, 0xe612641865679a63ull, 0x81f14fae158c5f6eull, 0x4fcb7e8f3f60c07eull,
+    0xa26da3999aef7749ull, 0xe3be5e330f38f09dull, 0xcb090c8001ab551cull, 0x5cadf5bfd3072cc5ull,
+    0xfdcb4fa002162a63ull, 0x73d9732fc7c8f7f6ull, 0x9e9f11c4014dda7eull, 0x2867e7fddcdd9afaull,
+    0xc646d63501a1511dull, 0xb281e1fd541501b8ull, 0xf7d88bc24209a565ull, 0x1f225a7ca91a4226ull,
+    0x9ae757596946075full, 0x3375788de9b06958ull, 0xc1a12d2fc3978937ull, 0x0052d6b1641c83aeull,
+    0xf209787bb47d6b84ull, 0xc0678c5dbd23a49aull, 0x9745eb4d50ce6332ull, 0xf840b7ba963646e0ull,
+    0xbd176620a501fbffull, 0xb650e5a93bc3d898ull, 0xec5d3fa8ce427affull, 0xa3e51f138ab4cebeull,
+    0x93ba47c980e98cdfull, 0xc66f336c36b10137ull, 0xb8a8d9bbe123f017ull, 0xb80b0047445d4184ull,
+    0xe6d3102ad96cec1dull, 0xa60dc059157491e5ull, 0x9043ea1ac7e41392ull, 0x87c89837ad68db2full,
+    0xb454e4a179dd1877ull, 0x29babe4598c311fbull, 0xe16a1dc9d8545e94ull, 0xf4296dd6fef3d67aull,
+    0x8ce2529e2734bb1dull, 0x1899e4a65f58660cull, 0xb01ae745b101e9e4ull, 0x5ec05dcff72e7f8full,
+    0xdc21a1171d42645dull, 0x76707543f4fa1f73ull, 0x899504ae72497ebaull, 0x6a06494a791c53a8ull,
+    0xabfa45da0edbde69ull, 0x0487db9d17636892ull, 0xd6f8d7509292d603ull, 0x45a9d2845d3c42b6ull,
+    0x865b86925b9bc5c2ull, 0x0b8a2392ba45a9b2ull, 0xa7f26836f282b732ull, 0x8e6cac7768d7141eull,
+    0xd1ef0244af2364ffull, 0x3207d795430cd926ull, 0x8335616aed761f1full, 0x7f44e6bd49e807b8ull,
+    0xa402b9c5a8d3a6e7ull, 0x5f16206c9c6209a6ull, 0xcd036837130890a1ull, 0x36dba887c37a8c0full,
+    0x802221226be55a64ull, 0xc2494954da2c9789ull, 0xa02aa96b06deb0fdull, 0xf2db9baa10b7bd6cull,
+    0xc83553c5c8965d3dull, 0x6f92829494e5acc7ull, 0xfa42a8b73abbf48cull, 0xcb772339ba1f17f9ull,
+    0x9c69a97284b578d7ull, 0xff2a760414536efbull, 0xc38413cf25e2d70dull, 0xfef5138519684abaull,
+    0xf46518c2ef5b8cd1ull, 0x7eb258665fc25d69ull, 0x98bf2f79d5993802ull, 0xef2f773ffbd97a61ull,
+    0xbeeefb584aff8603ull, 0xaafb550ffacfd8faull, 0xeeaaba2e5dbf6784ull, 0x95ba2a53f983cf38ull,
+    0x952ab45cfa97a0b2ull, 0xdd945a747bf26183ull, 0xba756174393d88dfull, 0x94f971119aeef9e4ull,
+    0xe912b9d1478ceb17ull, 0x7a37cd5601aab85dull, 0x91abb422ccb812eeull, 0xac62e055c10ab33aull,
+    0xb616a12b7fe617aaull, 0x577b986b314d6009ull, 0xe39c49765fdf9d94ull, 0xed5a7e85fda0b80bull,
+    0x8e41ade9fbebc27dull, 0x14588f13be847307ull, 0xb1d219647ae6b31cull, 0x596eb2d8ae258fc8ull,
+    0xde469fbd99a05fe3ull, 0x6fca5f8ed9aef3bbull, 0x8aec23d680043beeull, 0x25de7bb9480d5854ull,
+    0xada72ccc20054ae9ull, 0xaf561aa79a10ae6aull, 0xd910f7ff28069da4ull, 0x1b2ba1518094da04ull,
+    0x87aa9aff79042286ull, 0x90fb44d2f05d0842ull, 0xa99541bf57452b28ull, 0x353a1607ac744a53ull,
+    0xd3fa922f2d1675f2ull, 0x42889b8997915ce8ull, 0x847c9b5d7c2e09b7ull, 0x69956135febada11ull,
+    0xa59bc234db398c25ull, 0x43fab9837e699095ull, 0xcf02b2c21207ef2eull, 0x94f967e45e03f4bbull,
+    0x8161afb94b44f57dull, 0x1d1be0eebac278f5ull, 0xa1ba1ba79e1632dcull, 0x6462d92a69731732ull,
+    0xca28a291859bbf93ull, 0x7d7b8f7503cfdcfeull, 0xfcb2cb35e702af78ull, 0x5cda735244c3d43eull,
+    0x9defbf01b061adabull, 0x3a0888136afa64a7ull, 0xc56baec21c7a1916ull, 0x088aaa1845b8fdd0ull,
+    0xf6c69a72a3989f5bull, 0x8aad549e57273d45ull, 0x9a3c2087a63f6399ull, 0x36ac54e2f678864bull,
+    0xc0cb28a98fcf3c7full, 0x84576a1bb416a7ddull, 0xf0fdf2d3f3c30b9full, 0x656d44a2a11c51d5ull,
+    0x969eb7c47859e743ull, 0x9f644ae5a4b1b325ull, 0xbc4665b596706114ull, 0x873d5d9f0dde1feeull,
+    0xeb57ff22fc0c7959ull, 0xa90cb506d155a7eaull, 0x9316ff75dd87cbd8ull, 0x09a7f12442d588f2ull,
+    0xb7dcbf5354e9beceull, 0x0c11ed6d538aeb2full, 0xe5d3ef282a242e81ull, 0x8f1668c8a86da5faull,
+    0x8fa475791a569d10ull, 0xf96e017d694487bcull, 0xb38d92d760ec4455ull, 0x37c981dcc395a9acull,
+    0xe070f78d3927556aull, 0x85bbe253f47b1417ull, 0x8c469ab843b89562ull, 0x93956d7478ccec8eull,
+    0xaf58416654a6babbull, 0x387ac8d1970027b2ull, 0xdb2e51bfe9d0696aull, 0x06997b05fcc0319eull,
+    0x88fcf317f22241e2ull, 0x441fece3bdf81f03ull, 0xab3c2fddeeaad25aull, 0xd527e81cad7626c3ull,
+    0xd60b3bd56a5586f1ull, 0x8a71e223d8d3b074ull, 0x85c7056562757456ull, 0xf6872d5667844e49ull,
+    0xa738c6bebb12d16cull, 0xb428f8ac016561dbull, 0xd106f86e69d785c7ull, 0xe13336d701beba52ull,
+    0x82a45b450226b39cull, 0xecc0024661173473ull, 0xa34d721642b06084ull, 0x27f002d7f95d0190ull,
+    0xcc20ce9bd35c78a5ull, 0x31ec038df7b441f4ull, 0xff290242c83396ceull, 0x7e67047175a15271ull,
+    0x9f79a169bd203e41ull, 0x0f0062c6e984d386ull, 0xc75809c42c684dd1ull, 0x52c07b78a3e60868ull,
+    0xf92e0c3537826145ull, 0xa7709a56ccdf8a82ull, 0x9bbcc7a142b17ccbull, 0x88a66076400bb691ull,
+    0xc2abf989935ddbfeull, 0x6acff893d00ea435ull, 0xf356f7ebf83552feull, 0x0583f6b8c4124d43ull,
+    0x98165af37b2153deull, 0xc3727a337a8b704aull, 0xbe1bf1b059e9a8d6ull, 0x744f18c0592e4c5cull,
+    0xeda2ee1c7064130cull, 0x1162def06f79df73ull, 0x9485d4d1c63e8be7ull, 0x8addcb5645ac2ba8ull,
+    0xb9a74a0637ce2ee1ull, 0x6d953e2bd7173692ull, 0xe8111c87c5c1ba99ull, 0xc8fa8db6ccdd0437ull,
+    0x910ab1d4db9914a0ull, 0x1d9c9892400a22a2ull, 0xb54d5e4a127f59c8ull, 0x2503beb6d00cab4bull,
+    0xe2a0b5dc971f303aull, 0x2e44ae64840fd61dull, 0x8da471a9de737e24ull, 0x5ceaecfed289e5d2ull,
+    0xb10d8e1456105dadull, 0x7425a83e872c5f47ull, 0xdd50f1996b947518ull, 0xd12f124e28f77719ull,
+    0x8a5296ffe33cc92full, 0x82bd6b70d99aaa6full, 0xace73cbfdc0bfb7bull, 0x636cc64d1001550bull,
+    0xd8210befd30efa5aull, 0x3c47f7e05401aa4eull, 0x8714a775e3e95c78ull, 0x65acfaec34810a71ull,
+    0xa8d9d1535ce3b396ull, 0x7f1839a741a14d0dull, 0xd31045a8341ca07cull, 0x1ede48111209a050ull,
+    0x83ea2b892091e44dull, 0x934aed0aab460432ull, 0xa4e4b66b68b65d60ull, 0xf81da84d5617853full,
+    0xce1de40642e3f4b9ull, 0x36251260ab9d668eull, 0x80d2ae83e9ce78f3ull, 0xc1d72b7c6b426019ull,
+    0xa1075a24e4421730ull, 0xb24cf65b8612f81full, 0xc94930ae1d529cfcull, 0xdee033f26797b627ull,
+    0xfb9b7cd9a4a7443cull, 0x169840ef017da3b1ull, 0x9d412e0806e88aa5ull, 0x8e1f289560ee864eull,
+    0xc491798a08a2ad4eull, 0xf1a6f2bab92a27e2ull, 0xf5b5d7ec8acb58a2ull, 0xae10af696774b1dbull,
+    0x9991a6f3d6bf1765ull, 0xacca6da1e0a8ef29ull, 0xbff610b0cc6edd3full, 0x17fd090a58d32af3ull,
+    0xeff394dcff8a948eull, 0xddfc4b4cef07f5b0ull, 0x95f83d0a1fb69cd9ull, 0x4abdaf101564f98eull,
+    0xbb764c4ca7a4440full, 0x9d6d1ad41abe37f1ull, 0xea53df5fd18d5513ull, 0x84c86189216dc5edull,
+    0x92746b9be2f8552cull, 0x32fd3cf5b4e49bb4ull, 0xb7118682dbb66a77ull, 0x3fbc8c33221dc2a1ull,
+    0xe4d5e82392a40515ull, 0x0fabaf3feaa5334aull, 0x8f05b1163ba6832dull, 0x29cb4d87f2a7400eull,
+    0xb2c71d5bca9023f8ull, 0x743e20e9ef511012ull, 0xdf78e4b2bd342cf6ull, 0x914da9246b255416ull,
+    0x8bab8eefb6409c1aull, 0x1ad089b6c2f7548eull, 0xae9672aba3d0c320ull, 0xa184ac2473b529b1ull,
+    0xda3c0f568cc4f3e8ull, 0xc9e5d72d90a2741eull, 0x8865899617fb1871ull, 0x7e2fa67c7a658892ull,
+    0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull, 0xd51ea6fa85785631ull, 0x552a74227f3ea565ull,
+    0x8533285c936b35deull, 0xd53a88958f87275full, 0xa67ff273b8460356ull, 0x8a892abaf368f137ull,
+    0xd01fef10a657842cull, 0x2d2b7569b0432d85ull, 0x8213f56a67f6b29bull, 0x9c3b29620e29fc73ull,
+    0xa298f2c501f45f42ull, 0x8349f3ba91b47b8full, 0xcb3f2f7642717713ull, 0x241c70a936219a73ull,
+    0xfe0efb53d30dd4d7ull, 0xed238cd383aa0110ull, 0x9ec95d1463e8a506ull, 0xf4363804324a40aaull,
+    0xc67bb4597ce2ce48ull, 0xb143c6053edcd0d5ull, 0xf81aa16fdc1b81daull, 0xdd94b7868e94050aull,
+    0x9b10a4e5e9913128ull, 0xca7cf2b4191c8326ull, 0xc1d4ce1f63f57d72ull, 0xfd1c2f611f63a3f0ull,
+    0xf24a01a73cf2dccfull, 0xbc633b39673c8cecull, 0x976e41088617ca01ull, 0xd5be0503e085d813ull,
+    0xbd49d14aa79dbc82ull, 0x4b2d8644d8a74e18ull, 0xec9c459d51852ba2ull, 0xddf8e7d60ed1219eull,
+    0x93e1ab8252f33b45ull, 0xcabb90e5c942b503ull, 0xb8da1662e7b00a17ull, 0x3d6a751f3b936243ull,
+    0xe7109bfba19c0c9dull, 0x0cc512670a783ad4ull, 0x906a617d450187e2ull, 0x27fb2b80668b24c5ull,
+    0xb484f9dc9641e9daull, 0xb1f9f660802dedf6ull, 0xe1a63853bbd26451ull, 0x5e7873f8a0396973ull,
+    0x8d07e33455637eb2ull, 0xdb0b487b6423e1e8ull, 0xb049dc016abc5e5full, 0x91ce1a9a3d2cda62ull,
+    0xdc5c5301c56b75f7ull, 0x7641a140cc7810fbull, 0x89b9b3e11b6329baull, 0xa9e904c87fcb0a9dull,
+    0xac2820d9623bf429ull, 0x546345fa9fbdcd44ull, 0xd732290fbacaf133ull, 0xa97c177947ad4095ull,
+    0x867f59a9d4bed6c0ull, 0x49ed8eabcccc485dull, 0xa81f301449ee8c70ull, 0x5c68f256bfff5a74ull,
+    0xd226fc195c6a2f8cull, 0x73832eec6fff3111ull, 0x83585d8fd9c25db7ull, 0xc831fd53c5ff7eabull,
+    0xa42e74f3d032f525ull, 0xba3e7ca8b77f5e55ull, 0xcd3a1230c43fb26full, 0x28ce1bd2e55f35ebull,
+    0x80444b5e7aa7cf85ull, 0x7980d163cf5b81b3ull, 0xa0555e361951c366ull, 0xd7e105bcc332621full,
+    0xc86ab5c39fa63440ull, 0x8dd9472bf3fefaa7ull, 0xfa856334878fc150ull, 0xb14f98f6f0feb951ull,
+    0x9c935e00d4b9d8d2ull, 0x6ed1bf9a569f33d3ull, 0xc3b8358109e84f07ull, 0x0a862f80ec4700c8ull,
+    0xf4a642e14c6262c8ull, 0xcd27bb612758c0faull, 0x98e7e9cccfbd7dbdull, 0x8038d51cb897789cull,
+    0xbf21e44003acdd2cull, 0xe0470a63e6bd56c3ull, 0xeeea5d5004981478ull, 0x1858ccfce06cac74ull,
+    0x95527a5202df0ccbull, 0x0f37801e0c43ebc8ull, 0xbaa718e68396cffdull, 0xd30560258f54e6baull,
+    0xe950df20247c83fdull, 0x47c6b82ef32a2069ull, 0x91d28b7416cdd27eull, 0x4cdc331d57fa5441ull,
+    0xb6472e511c81471dull, 0xe0133fe4adf8e952ull, 0xe3d8f9e563a198e5ull, 0x58180fddd97723a6ull,
+    0x8e679c2f5e44ff8full, 0x570f09eaa7ea7648ull,
+};
+
+/**
+ * @brief Returns the bits of the double nearest to w * 10^q, ties to even, with underflow giving zero and overflow
+ * infinity. w must hold the exact significand.
+ */
+static u64 _j_eisel_lemire(i64 q, u64 w) {
+    if (w == 0 || q < _J_F64_SMALLEST_POWER_OF_TEN) return 0;
+    if (q > _J_F64_LARGEST_POWER_OF_TEN) return 0x7FFull << 52;
+    i32 lz = __builtin_clzll(w);
+    w <<= lz;
+    // 55 bits are needed: 53 for the significand, one to detect the carry and one to round.
+    u32 index = cast(u32, 2 * (q - _J_F64_SMALLEST_POWER_OF_TEN));
+    unsigned __int128 first = cast(unsigned __int128, w) * _j_pow5_128[index];
+    u64 high = cast(u64, first >> 64);
+    u64 low = cast(u64, first);
+    const u64 precision_mask = 0xFFFFFFFFFFFFFFFFull >> 55;
+    if ((high & precision_mask) == precision_mask) {
+        // The truncated product is too close to a rounding boundary, so the low half of the power is needed too.
+        u64 second_high = cast(u64, (cast(unsigned __int128, w) * _j_pow5_128[index + 1]) >> 64);
+        low += second_high;
+        if (second_high > low) high++;
+    }
+    i32 upper_bit = cast(i32, high >> 63);
+    i32 shift = upper_bit + 64 - 52 - 3;
+    u64 mantissa = high >> shift;
+    // floor(log2(10^q)) + 63, and -1023 + 1 shifts the binary exponent into its biased form.
+    i32 power2 = cast(i32, (((152170 + 65536) * q) >> 16) + 63 + upper_bit - lz + 1023);
+    if (power2 <= 0) {
+        // A subnormal: shift the significand into place before rounding.
+        if (-power2 + 1 >= 64) return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ull << 52) ? 0 : 1;
+        return (mantissa & ((1ull << 52) - 1)) | (cast(u64, power2) << 52);
+    }
+    // Ties can only be exact for small exponents, and there they round to even instead of up.
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~1ull;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ull << 52)) {
+        mantissa = 1ull << 52;
+        power2++;
+    }
+    mantissa &= ~(1ull << 52);
+    if (power2 >= 0x7FF) return 0x7FFull << 52;
+    return mantissa | (cast(u64, power2) << 52);
+}
+
+static f64 _j_parse_f64_fallback(const char *s, u32 len) {
+    char local[256];
+    char *copy = local;
+    Arena *scratch = NULL;
+    if (len >= sizeof(local)) {
+        j_maybe(ArenaPtr) mscratch = j_get_scratch();
+        jassert(mscratch.is_present, "Precondition: The scratch space must be initialized before calling this function.\n");
+        scratch = mscratch.value;
+        copy = j_alloc(scratch, len + 1);
+    }
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    f64 value = strtod(copy, NULL);
+    if (scratch != NULL) j_release_scratch(scratch);
+    return value;
+}
+
+j_maybe(f64) j_ss_parse_f64(SubStr ss) {
+    const char *s = ss.str.str;
+    u32 len = ss.str.len;
+    u32 i = 0;
+    bool negative = false;
+    if (i < len && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+    // The significand keeps the first 19 significant digits in w, with exponent tracking the position of the
+    // point. Leading zeros are skipped so they do not count towards the 19.
+    u64 w = 0;
+    i64 exponent = 0;
+    u32 significant = 0;
+    bool truncated = false;
+    bool any_digits = false;
+    while (i < len && s[i] == '0') {
+        i++;
+        any_digits = true;
+    }
+    for (; i < len && cast(u8, s[i] - '0') <= 9; ++i) {
+        any_digits = true;
+        if (significant < 19) {
+            w = w * 10 + cast(u8, s[i] - '0');
+            significant++;
+        } else {
+            truncated |= s[i] != '0';
+            exponent++;
+        }
+    }
+    if (i < len && s[i] == '.') {
+        i++;
+        if (w == 0) {
+            for (; i < len && s[i] == '0'; ++i) {
+                exponent--;
+                any_digits = true;
+            }
+        }
+        for (; significant + 8 <= 19 && i + 8 <= len; i += 8) {
+            u64 word;
+            memcpy(&word, s + i, 8);
+            if (!_j_is_eight_digits(word)) break;
+            w = w * 100000000 + _j_parse_eight_digits(word);
+            significant += 8;
+            exponent -= 8;
+            any_digits = true;
+        }
+        for (; i < len && cast(u8, s[i] - '0') <= 9; ++i) {
+            any_digits = true;
+            if (significant < 19) {
+                w = w * 10 + cast(u8, s[i] - '0');
+                significant++;
+                exponent--;
+            } else {
+                truncated |= s[i] != '0';
+            }
+        }
+    }
+    if (!any_digits) return (j_maybe(f64)) { .is_present = false };
+    if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        bool negative_exponent = false;
+        if (i < len && (s[i] == '-' || s[i] == '+')) negative_exponent = s[i++] == '-';
+        if (i == len) return (j_maybe(f64)) { .is_present = false };
+        i64 explicit_exponent = 0;
+        for (; i < len && cast(u8, s[i] - '0') <= 9; ++i) {
+            // Anything this large is already out of range, so the exponent saturates instead of overflowing.
+            if (explicit_exponent < 0x10000000) explicit_exponent = explicit_exponent * 10 + (s[i] - '0');
+        }
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+    if (i != len) return (j_maybe(f64)) { .is_present = false };
+
+    f64 value;
+    // Clinger: when w and 10^|exponent| are both exact doubles, one correctly rounded operation is exact too.
+    static const f64 powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    if (!truncated && w <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        value = exponent < 0 ? cast(f64, w) / powers_of_ten[-exponent] : cast(f64, w) * powers_of_ten[exponent];
+    } else {
+        u64 bits = _j_eisel_lemire(exponent, w);
+        // The dropped digits put the true value between w and w + 1, which only matters if those round apart.
+        if (truncated && bits != _j_eisel_lemire(exponent, w + 1)) {
+            value = _j_parse_f64_fallback(s, len);
+            return (j_maybe(f64)) { .is_present = true, .value = value };
+        }
+        memcpy(&value, &bits, sizeof(value));
+    }
+    return (j_maybe(f64)) { .is_present = true, .value = negative ? -value : value };
+}
+
+#undef _J_F64_SMALLEST_POWER_OF_TEN
+#undef _J_F64_LARGEST_POWER_OF_TEN
+
+// MARK: - Multi Pattern Matching Implementation
+
+static inline u8 _j_ascii_lower(u8 c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+AhoCorasick j_make_aho_corasick(Arena *arena, const j_list(Str) needles, bool ignore_ascii_case) {
+    AhoCorasick ac = { .pattern_count = cast(u32, j_al_len(needles)) };
+    u64 total_len = 0;
+    bool used[256] = { false };
+    for (u32 p = 0; p < ac.pattern_count; ++p) {
+        jassert(needles[p].len > 0, "Precondition: The needles must not be empty\n");
+        total_len += needles[p].len;
+        for (u32 i = 0; i < needles[p].len; ++i) {
+            u8 c = cast(u8, needles[p].str[i]);
+            used[ignore_ascii_case ? _j_ascii_lower(c) : c] = true;
+        }
+    }
+    // Class 0 is every byte that no needle contains.
+    ac.class_count = 1;
+    for (u32 c = 0; c < 256; ++c) {
+        ac.byte_class[c] = used[c] ? cast(u16, ac.class_count++) : 0;
+    }
+    if (ignore_ascii_case) {
+        for (u32 c = 'A'; c <= 'Z'; ++c) ac.byte_class[c] = ac.byte_class[c + ('a' - 'A')];
+    }
+    jassert((total_len + 1) * ac.class_count < J_AC_OUTPUT_BIT, "Precondition: The needles are too long to compile\n");
+
+    // The trie has at most one state per needle byte, plus the root.
+    u64 max_states = total_len + 1;
+    u64 table_size = max_states * ac.class_count;
+    // One allocation holds every array.
+    u64 words = table_size + 3 * max_states + 2 * cast(u64, ac.pattern_count);
+    u32 *block = _j_alloc_aligned(arena, words * sizeof(u32), _Alignof(u32));
+    ac.table = block;
+    ac.state_pattern = ac.table + table_size;
+    ac.output = ac.state_pattern + max_states;
+    ac.next_output = ac.output + max_states;
+    ac.pattern_next = ac.next_output + max_states;
+    ac.pattern_lens = ac.pattern_next + ac.pattern_count;
+    memset(ac.table, 0, table_size * sizeof(u32));
+    memset(ac.state_pattern, 0xFF, max_states * sizeof(u32));
+    j_maybe(ArenaPtr) mscratch = j_get_scratch();
+    jassert(mscratch.is_present, "Precondition: The scratch space must be initialized before calling this function.\n");
+    Arena *scratch = mscratch.value;
+    u32 *fail = _j_alloc_aligned(scratch, (max_states + ac.pattern_count) * sizeof(u32), _Alignof(u32));
+    u32 *needle_state = fail + max_states;
+
+    // The needles are inserted a level at a time, so states are numbered breadth first. The shallow states, where
+    // a scan spends nearly all its time, then have neighbouring rows, and every state comes after its failure state.
+    u32 max_len = 0;
+    for (u32 p = 0; p < ac.pattern_count; ++p) {
+        needle_state[p] = 0;
+        if (needles[p].len > max_len) max_len = needles[p].len;
+    }
+    ac.state_count = 1;
+    for (u32 depth = 0; depth < max_len; ++depth) {
+        for (u32 p = 0; p < ac.pattern_count; ++p) {
+            if (depth >= needles[p].len) continue;
+            u32 *slot = &ac.table[needle_state[p] * ac.class_count + ac.byte_class[cast(u8, needles[p].str[depth])]];
+            if (*slot == 0) *slot = ac.state_count++;
+            needle_state[p] = *slot;
+        }
+    }
+    for (u32 p = ac.pattern_count; p-- > 0;) {
+        // Chaining in reverse leaves equal needles in list order.
+        ac.pattern_next[p] = ac.state_pattern[needle_state[p]];
+        ac.state_pattern[needle_state[p]] = p;
+        ac.pattern_lens[p] = needles[p].len;
+    }
+
+    // Walking the states in order visits each after its failure state, so the missing transitions can be copied
+    // from that state's finished row, turning the trie into a full DFA.
+    fail[0] = 0;
+    ac.output[0] = 0;
+    ac.next_output[0] = 0;
+    for (u32 state = 0; state < ac.state_count; ++state) {
+        u32 *row = &ac.table[state * ac.class_count];
+        const u32 *fail_row = &ac.table[fail[state] * ac.class_count];
+        for (u32 c = 0; c < ac.class_count; ++c) {
+            u32 child = row[c];
+            if (child == 0) {
+                if (state != 0) row[c] = fail_row[c];
+                continue;
+            }
+            fail[child] = state == 0 ? 0 : fail_row[c];
+            ac.next_output[child] = ac.output[fail[child]];
+            ac.output[child] = ac.state_pattern[child] != UINT32_MAX ? child : ac.next_output[child];
+        }
+    }
+    j_release_scratch(scratch);
+    // Rows are addressed by offset while scanning, and the top bit flags a state with output.
+    for (u64 i = 0; i < cast(u64, ac.state_count) * ac.class_count; ++i) {
+        u32 target = ac.table[i];
+        ac.table[i] = target * ac.class_count | (ac.output[target] != 0 ? J_AC_OUTPUT_BIT : 0);
+    }
+    return ac;
+}
+
+j_list(AcMatch) j_ac_find_all(const AhoCorasick *ac, Arena *arena, const Str hay) {
+    j_list(AcMatch) matches = EMPTY_ARRAY;
+    const u8 *s = cast(const u8 *, hay.str);
+    u32 offset = 0;
+    for (u32 i = 0; i < hay.len; ++i) {
+        u32 entry = ac->table[offset + ac->byte_class[s[i]]];
+        offset = entry & ~J_AC_OUTPUT_BIT;
+        if (entry & J_AC_OUTPUT_BIT) {
+            for (u32 state = ac->output[offset / ac->class_count]; state != 0; state = ac->next_output[state]) {
+                for (u32 p = ac->state_pattern[state]; p != UINT32_MAX; p = ac->pattern_next[p]) {
+                    j_al_append(matches, arena, ((AcMatch) { .pattern = p, .start = i + 1 - ac->pattern_lens[p], .end = i + 1 }));
+                }
+            }
+        }
+    }
+    return matches;
 }
 
-void j_ss_trim_front_whitespace(SubStr *ss) {
-    j_ss_remove_while(ss, j_ss_it == ' ' || j_ss_it == '\n' || j_ss_it == '\r' || j_ss_it == '\t');
+j_maybe(AcMatch) j_ac_find_first(const AhoCorasick *ac, const Str hay) {
+    const u8 *s = cast(const u8 *, hay.str);
+    u32 offset = 0;
+    for (u32 i = 0; i < hay.len; ++i) {
+        u32 entry = ac->table[offset + ac->byte_class[s[i]]];
+        offset = entry & ~J_AC_OUTPUT_BIT;
+        if (entry & J_AC_OUTPUT_BIT) {
+            u32 p = ac->state_pattern[ac->output[offset / ac->class_count]];
+            return (j_maybe(AcMatch)) { .is_present = true, .value = { .pattern = p, .start = i + 1 - ac->pattern_lens[p], .end = i + 1 } };
+        }
+    }
+    return (j_maybe(AcMatch)) { .is_present = false };
 }
+
 // MARK: - Argument Parser
 
 // MARK: - FileSystem
@@ -1011,6 +5662,40 @@ inline void j_free(Arena *arena, void *ptr, u64 size) {
     }
 }
 
+bool j_extend(Arena *arena, void *ptr, u64 size, u64 new_size) {
+    jassert(new_size >= size, "Precondition: An allocation can only be extended to a larger size\n");
+    if (!arena->flags.allocation_scheme_linear || arena->flags.use_free_list) {
+        return false;
+    }
+    if (ptr + size != arena->stack.memory + arena->stack.used ||
+        arena->stack.size - arena->stack.used < new_size - size) {
+        return false;
+    }
+    if (arena->flags.zero_initialized) {
+        memset(ptr + size, 0, new_size - size);
+    }
+    arena->stack.used += new_size - size;
+    return true;
+}
+
+void *_j_alloc_aligned(Arena *arena, u64 size, u64 align) {
+    jassert(align != 0 && (align & (align - 1)) == 0, "Precondition: The alignment must be a power of two\n");
+    if (arena->flags.allocation_scheme_linear && !arena->flags.use_free_list) {
+        u64 pad = -cast(uintptr_t, arena->stack.memory + arena->stack.used) & (align - 1);
+        u8 *raw = j_alloc(arena, pad + _j_align_up(size, align));
+        return raw + pad;
+    }
+    u8 *raw = j_alloc(arena, size + align - 1);
+    return cast(void *, _j_align_up(cast(uintptr_t, raw), align));
+}
+
+void _j_free_aligned(Arena *arena, void *ptr, u64 size, u64 align) {
+    // Other arenas would need the unaligned pointer that j_alloc returned, so they keep the memory.
+    if (arena->flags.allocation_scheme_linear && !arena->flags.use_free_list) {
+        j_free(arena, ptr, _j_align_up(size, align));
+    }
+}
+
 void j_init_scratch(Arena *program_memory, i32 arena_count, u64 total_scratch_available) {
     jassert(program_memory->stack.size - program_memory->stack.used >= total_scratch_available,
             "The total scratch available is larger than the program_memory size\n");
@@ -1157,7 +5842,23 @@ bool j_hmap_compare_str(const void *lhs, const void *rhs, size_t len) {
 }
 
 u64 j_hmap_hash_str(const void *key, size_t len) {
-    return j_hmap_generic_hash(((Str *)key)->str, ((Str *)key)->len);
+    return str_hash(*(Str *)key);
+}
+
+bool j_hmap_compare_hstr(const void *lhs, const void *rhs, size_t len) {
+    return hstr_eq(*(HStr *)lhs, *(HStr *)rhs);
+}
+
+u64 j_hmap_hash_hstr(const void *key, size_t len) {
+    return ((HStr *)key)->hash;
+}
+
+bool j_hmap_compare_sstr(const void *lhs, const void *rhs, size_t len) {
+    return sstr_eq(*(SmallStr *)lhs, *(SmallStr *)rhs);
+}
+
+u64 j_hmap_hash_sstr(const void *key, size_t len) {
+    return sstr_hash(*(SmallStr *)key);
 }
 
 
@@ -1174,32 +5875,22 @@ void str_register(Arena *perm_arena, const char * _Nonnull format, const Str (*
 
 static const Str i32_Printer(Arena *arena, va_list * _Nonnull args) {
     i32 number = va_arg(*args, i32);
-    u32 len = 0;
-    i32 temp = number;
     if (number == 0) {
         return str_from_lit("0");
     }
-    if (temp < 0) {
-        len++;
-        temp = -temp;
-    }
-    while (temp > 0) {
+    // Negate in unsigned arithmetic, since the minimum has no positive counterpart.
+    u32 magnitude = number < 0 ? 0 - cast(u32, number) : cast(u32, number);
+    u32 len = number < 0;
+    for (u32 temp = magnitude; temp > 0; temp /= 10) {
         len++;
-        temp /= 10;
     }
     char *str = (char *)j_alloc(arena, len + 1);
     str[len] = '\0';
-    temp = number;
-    if (temp < 0) {
-        str[0] = '-';
-        temp = -temp;
-    }
-    for (u32 i = len - 1; i > 0; i--) {
-        str[i] = (temp % 10) + '0';
-        temp /= 10;
+    for (u32 i = len; magnitude > 0; magnitude /= 10) {
+        str[--i] = (magnitude % 10) + '0';
     }
-    if (number >= 0) {
-        str[0] = (temp % 10) + '0';
+    if (number < 0) {
+        str[0] = '-';
     }
     return (Str){str, len};
 }
@@ -1228,32 +5919,22 @@ static const Str u32_Printer(Arena *arena, va_list * _Nonnull args) {
 
 static const Str i64_Printer(Arena *arena, va_list * _Nonnull args) {
     i64 number = va_arg(*args, i64);
-    u32 len = 0;
-    i64 temp = number;
     if (number == 0) {
         return str_from_lit("0");
     }
-    if (temp < 0) {
-        len++;
-        temp = -temp;
-    }
-    while (temp > 0) {
+    // Negate in unsigned arithmetic, since the minimum has no positive counterpart.
+    u64 magnitude = number < 0 ? 0 - cast(u64, number) : cast(u64, number);
+    u32 len = number < 0;
+    for (u64 temp = magnitude; temp > 0; temp /= 10) {
         len++;
-        temp /= 10;
     }
     char *str = (char *)j_alloc(arena, len + 1);
     str[len] = '\0';
-    temp = number;
-    if (temp < 0) {
-        str[0] = '-';
-        temp = -temp;
+    for (u32 i = len; magnitude > 0; magnitude /= 10) {
+        str[--i] = (magnitude % 10) + '0';
     }
-    for (u32 i = len - 1; i > 0; i--) {
-        str[i] = (temp % 10) + '0';
-        temp /= 10;
-    }
-    if (number >= 0) {
-        str[0] = (temp % 10) + '0';
+    if (number < 0) {
+        str[0] = '-';
     }
     return (Str){str, len};
 }
@@ -1367,87 +6048,31 @@ static const Str f32_Printer(Arena *arena, va_list * _Nonnull args) {
 
 static const Str f64_Printer(Arena *arena, va_list * _Nonnull args) {
     f64 number = va_arg(*args, f64);
-
-    i64 int_part = (i64)number;
-    f64 frac_part = (number - int_part);
-    i32 pad_with_zero = -1;
-    u32 frac_len = 0;
-    while (frac_part != (i64)frac_part) {
-        if ((i64)frac_part == 0) {
-            pad_with_zero++;
-        } else {
-            ++frac_len;
+    // Print the fewest significant digits that read back as the same double, so j_ss_parse_f64 round trips every
+    // finite value, subnormals included.
+    char buf[32];
+    i32 len = 0;
+    for (i32 precision = 1; precision <= 17; ++precision) {
+        len = snprintf(buf, sizeof(buf), "%.*g", precision, number);
+        if (strtod(buf, NULL) == number) {
+            break;
         }
-        frac_part *= 10;
     }
-    i64 frac_part_i32 = (i64)frac_part;
-
-    Str int_str;
-    {
-        u32 len = 0;
-        i64 temp = int_part;
-        if (temp == 0) {
-            int_str = str_from_lit("0");
-        } else {
-            if (temp < 0) {
-                len++;
-                temp = -temp;
-            }
-            while (temp > 0) {
-                len++;
-                temp /= 10;
-            }
-            char *str = (char *)j_alloc(arena, len + 1);
-            str[len] = '\0';
-            temp = int_part;
-            if (temp < 0) {
-                str[0] = '-';
-                temp = -temp;
-            }
-            for (u32 i = len - 1; i > 0; i--) {
-                str[i] = (temp % 10) + '0';
-                temp /= 10;
-            }
-            if (temp >= 0) {
-                str[0] = (temp % 10) + '0';
-            }
-            int_str = (Str) {str, len};
+    // Keep integral values looking like floating point numbers, e.g. 3.0 instead of 3.
+    bool integral = true;
+    for (i32 i = 0; i < len; ++i) {
+        if (buf[i] != '-' && (buf[i] < '0' || buf[i] > '9')) {
+            integral = false;
         }
     }
-    Str frac_str;
-    {
-        u32 len = 1 + frac_len;
-        i64 temp = frac_part_i32;
-        if (number == 0) {
-            frac_str = str_from_lit("0");
-        } else {
-            if (temp < 0) {
-                temp = -temp;
-            }
-            len += pad_with_zero;
-            char *str = (char *)j_alloc(arena, len + 1);
-            str[len] = '\0';
-            temp = frac_part_i32;
-            if (temp < 0) {
-                temp = -temp;
-            }
-            for (u32 i = len - 1; i > 0; i--) {
-                str[i] = (temp % 10) + '0';
-                temp /= 10;
-            }
-            if (temp >= 0) {
-                str[0] = (temp % 10) + '0';
-            }
-            for (i32 i = 0; i < pad_with_zero; i++) {
-                str[i] = '0';
-            }
-            frac_str = (Str) {str, len};
-        }
+    if (integral) {
+        buf[len++] = '.';
+        buf[len++] = '0';
     }
-
-    const Str dot_str = str_from_lit(".");
-    const Str out = str_concat(arena, int_str, str_concat(arena, dot_str, frac_str));
-    return out;
+    char *str = (char *)j_alloc(arena, len + 1);
+    memcpy(str, buf, len);
+    str[len] = '\0';
+    return (Str){str, cast(u32, len)};
 }
 
 static const Str bool_Printer(Arena *arena, va_list * _Nonnull args) {
@@ -1477,7 +6102,12 @@ static void init_printers(Arena *arena) { // __attribute__((constructor)) {
 }
 //#endif
 static inline const Str str_format_impl(Arena *arena, const Str format, va_list args ) {
-    Str *strs = EMPTY_ARRAY;
+    // Most formats have only a few placeholders, so the fragments rarely leave the inline storage.
+    j_small_list(Str, 16) strs = EMPTY_SMALL_LIST;
+    // Printers take a va_list *. Where va_list is an array type, a va_list parameter has decayed to a pointer and
+    // &args would not have that type, so the printers get a local copy.
+    va_list printer_args;
+    va_copy(printer_args, args);
     j_maybe(ArenaPtr) mscratch = j_get_scratch();
     jassert(mscratch.is_present, "Precondition: The scratch space must be initialized before calling this function.\n");
     Arena *scratch = mscratch.value;
@@ -1486,13 +6116,13 @@ static inline const Str str_format_impl(Arena *arena, const Str format, va_list
     for (u32 i = 0; i < format.len; i++) {
         if (format.str[i] == '\\' && format.str[i + 1] == '{') {
             // We want to print upto here, but not the next character.
-            j_al_append(strs, scratch, ((Str) { .str = format.str + last_printed, .len = i - last_printed }));
+            j_small_list_append(strs, scratch, ((Str) { .str = format.str + last_printed, .len = i - last_printed }));
             i++;
             last_printed = i;
             continue;
         }
         if (format.str[i] == '{') {
-            j_al_append(strs, scratch, ((Str) { .str = format.str + last_printed, .len = i - last_printed }));
+            j_small_list_append(strs, scratch, ((Str) { .str = format.str + last_printed, .len = i - last_printed }));
             u32 j = i;
             bool found = false;
             while (j < format.len) {
@@ -1509,8 +6139,8 @@ static inline const Str str_format_impl(Arena *arena, const Str format, va_list
                 found = false;
                 for ( u32 k = 0; k < j_al_len(options); k++ ) {
                     if ( str_eq( option, options[k].format ) ) {
-                        const Str fmt = options[k].printer(scratch, &args);
-                        j_al_append(strs, scratch, fmt);
+                        const Str fmt = options[k].printer(scratch, &printer_args);
+                        j_small_list_append(strs, scratch, fmt);
                         i = j;
                         found = true;
                         break;
@@ -1522,9 +6152,11 @@ static inline const Str str_format_impl(Arena *arena, const Str format, va_list
             }
         }
     }
-    j_al_append(strs, scratch, ((Str) { .str = format.str + last_printed, .len = format.len - last_printed}));
+    j_small_list_append(strs, scratch, ((Str) { .str = format.str + last_printed, .len = format.len - last_printed}));
+
+    va_end(printer_args);
 
-    Str out = str_build_from_arraylist(arena, strs);
+    Str out = str_build_from_array(arena, j_small_list_data(strs), j_small_list_len(strs));
     j_release_scratch(scratch);
     return out;
 }
@@ -1573,12 +6205,8 @@ void __attribute__((overloadable)) print(const Str format, ...) {
 const Str str_concat(Arena *arena, const Str prefix, const Str suffix) {
     u32 len = prefix.len + suffix.len;
     char *str = (char*)j_alloc(arena, len + 1);
-    for (u32 i = 0; i < prefix.len; i++) {
-        str[i] = prefix.str[i];
-    }
-    for (u32 i = 0; i < suffix.len; i++) {
-        str[prefix.len + i] = suffix.str[i];
-    }
+    memcpy(str, prefix.str, prefix.len);
+    memcpy(str + prefix.len, suffix.str, suffix.len);
     str[len] = '\0';
     Str c = {str, len};
     return c;
@@ -1588,62 +6216,368 @@ bool str_eq(Str a, Str b) {
     if (a.len != b.len) {
         return 0;
     }
-    for (u32 i = 0; i < a.len; i++) {
-        if (a.str[i] != b.str[i]) {
-            return 0;
-        }
+    if (a.len == 0 || a.str == b.str) {
+        return 1;
     }
-    return 1;
+    // Most unequal strings of the same length already differ in the first byte.
+    return a.str[0] == b.str[0] && memcmp(a.str, b.str, a.len) == 0;
 }
 
 bool str_start_with(const Str str, const Str prefix) {
     if (str.len < prefix.len) {
         return 0;
     }
-    for (u32 i = 0; i < prefix.len; i++) {
-        if (str.str[i] != prefix.str[i]) {
-            return 0;
-        }
-    }
-    return 1;
+    return memcmp(str.str, prefix.str, prefix.len) == 0;
 }
 
 bool str_contains(const Str hay, const Str needle) {
-    if (hay.len < needle.len) {
-        return 0;
+    // Every string contains the empty string, whether or not its pointer is NULL.
+    if (needle.len == 0) return true;
+    return _j_str_find(hay.str, hay.len, needle.str, needle.len) != NULL;
+}
+
+#define _j_str_hash_seed(len) (0x9e3779b97f4a7c15ull ^ (len))
+#define _j_str_hash_round(hash, word) ({ \
+    (hash) = ((hash) ^ (word)) * 0xff51afd7ed558ccdull; \
+    (hash) ^= (hash) >> 32; \
+})
+#define _j_str_hash_finish(hash) ({ \
+    (hash) ^= (hash) >> 33; \
+    (hash) *= 0xc4ceb9fe1a85ec53ull; \
+    (hash) ^= (hash) >> 33; \
+})
+
+u64 str_hash(const Str str) {
+    u64 hash = _j_str_hash_seed(str.len);
+    u32 i = 0;
+    for (; i + 8 <= str.len; i += 8) {
+        u64 word;
+        memcpy(&word, str.str + i, 8);
+        _j_str_hash_round(hash, word);
     }
-    for (u32 i = 0; i < hay.len - needle.len; i++) {
-        bool found = 1;
-        for (u32 j = 0; j < needle.len; j++) {
-            if (hay.str[i + j] != needle.str[j]) {
-                found = 0;
-                break;
-            }
-        }
-        if (found) {
-            return 1;
-        }
+    if (i < str.len) {
+        u64 word = 0;
+        memcpy(&word, str.str + i, str.len - i);
+        _j_str_hash_round(hash, word);
     }
-    return 0;
+    _j_str_hash_finish(hash);
+    return hash;
 }
 
-Str str_build_from_arraylist(Arena *arena, const j_list(Str) list) {
+HStr hstr_from_str(const Str str) {
+    return (HStr) { .str = str, .hash = str_hash(str) };
+}
+
+bool hstr_eq(const HStr a, const HStr b) {
+    return a.hash == b.hash && str_eq(a.str, b.str);
+}
+
+SmallStr sstr_from_str(Arena *arena, const Str str) {
+    SmallStr sstr = { .words = { 0, 0 } };
+    if (str.len <= J_SMALL_STR_INLINE) {
+        memcpy(sstr.chars, str.str, str.len);
+        sstr.tag = cast(u8, J_SMALL_STR_INLINE - str.len);
+    } else {
+        char *heap_str = j_alloc(arena, str.len + 1);
+        memcpy(heap_str, str.str, str.len);
+        heap_str[str.len] = '\0';
+        sstr.heap_str = heap_str;
+        sstr.heap_len = str.len;
+        sstr.tag = J_SMALL_STR_HEAP;
+    }
+    return sstr;
+}
+
+Str sstr_view(const SmallStr *sstr) {
+    if (sstr_is_inline(*sstr)) {
+        return (Str) { .str = cast(char *, sstr->chars), .len = sstr_len(*sstr) };
+    }
+    return (Str) { .str = sstr->heap_str, .len = sstr->heap_len };
+}
+
+bool sstr_eq(const SmallStr a, const SmallStr b) {
+    // The second word holds the tail and tag of an inline string, or the length and tag of a heap one, so
+    // strings that differ in length or representation already differ here.
+    if (a.words[1] != b.words[1]) return false;
+    if (sstr_is_inline(a)) return a.words[0] == b.words[0];
+    return a.heap_str == b.heap_str || memcmp(a.heap_str, b.heap_str, a.heap_len) == 0;
+}
+
+bool sstr_eq_str(const SmallStr *a, const Str b) {
+    return str_eq(sstr_view(a), b);
+}
+
+u64 sstr_hash(SmallStr sstr) {
+    if (!sstr_is_inline(sstr)) {
+        return str_hash(sstr_view(&sstr));
+    }
+    // The unused inline bytes are zero, exactly the padding str_hash gives its last word, so the words can be
+    // hashed in place once the tag is masked off.
+    u32 len = sstr_len(sstr);
+    sstr.tag = 0;
+    u64 hash = _j_str_hash_seed(len);
+    if (len > 0) _j_str_hash_round(hash, sstr.words[0]);
+    if (len > 8) _j_str_hash_round(hash, sstr.words[1]);
+    _j_str_hash_finish(hash);
+    return hash;
+}
+
+Str str_build_from_array(Arena *arena, const Str *strs, u64 count) {
     u32 total_len = 0;
-    for (u32 i = 0; i < j_al_len(list); i++) {
-        total_len += list[i].len;
+    for (u64 i = 0; i < count; i++) {
+        total_len += strs[i].len;
     }
     char *str = (char*)j_alloc(arena, total_len + 1);
     u32 offset = 0;
-    for (u32 i = 0; i < j_al_len(list); ++i) {
-        for (u32 j = 0; j < list[i].len; j++) {
-            str[offset + j] = list[i].str[j];
-        }
-        offset += list[i].len;
+    for (u64 i = 0; i < count; ++i) {
+        memcpy(str + offset, strs[i].str, strs[i].len);
+        offset += strs[i].len;
     }
     str[total_len] = '\0';
     return (Str){str, total_len};
 }
 
+Str str_build_from_arraylist(Arena *arena, const j_list(Str) list) {
+    return str_build_from_array(arena, list, j_al_len(list));
+}
+
+// MARK: - String Builder Implementation
+
+StrBuilder j_sb_make(Arena *arena, u32 capacity) {
+    StrBuilder sb = { .arena = arena };
+    if (capacity > 0) {
+        sb.buf = j_alloc(arena, capacity);
+        sb.cap = capacity;
+    }
+    return sb;
+}
+
+static void _j_sb_grow(StrBuilder *sb, u64 needed) {
+    jassert(needed <= UINT32_MAX, "Precondition: A Str can not be longer than UINT32_MAX\n");
+    u64 new_cap = cast(u64, sb->cap) * 2;
+    if (new_cap < needed) new_cap = needed;
+    if (new_cap < J_SB_INITIAL_CAP) new_cap = J_SB_INITIAL_CAP;
+    if (new_cap > UINT32_MAX) new_cap = UINT32_MAX;
+    Arena *arena = sb->arena;
+    // While the buffer is the last allocation of a linear arena it can grow without moving.
+    if (sb->buf != NULL && j_extend(arena, sb->buf, sb->cap, new_cap)) {
+        sb->cap = cast(u32, new_cap);
+        return;
+    }
+    char *buf = j_alloc(arena, new_cap);
+    if (sb->buf != NULL) {
+        memcpy(buf, sb->buf, sb->len);
+        j_free(arena, sb->buf, sb->cap);
+    }
+    sb->buf = buf;
+    sb->cap = cast(u32, new_cap);
+}
+
+void j_sb_reserve(StrBuilder *sb, u32 n) {
+    if (cast(u64, sb->len) + n > sb->cap) {
+        _j_sb_grow(sb, cast(u64, sb->len) + n);
+    }
+}
+
+void j_sb_append(StrBuilder *sb, const Str str) {
+    if (str.len == 0) return;
+    j_sb_reserve(sb, str.len);
+    memcpy(sb->buf + sb->len, str.str, str.len);
+    sb->len += str.len;
+}
+
+void j_sb_append_char(StrBuilder *sb, char c) {
+    if (sb->len == sb->cap) {
+        _j_sb_grow(sb, cast(u64, sb->len) + 1);
+    }
+    sb->buf[sb->len++] = c;
+}
+
+void j_sb_append_u64(StrBuilder *sb, u64 number) {
+    // Digits are produced from the back of a local buffer, then copied in one go.
+    char digits[20];
+    u32 i = sizeof(digits);
+    do {
+        digits[--i] = cast(char, '0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+    j_sb_append(sb, (Str) { .str = digits + i, .len = sizeof(digits) - i });
+}
+
+void j_sb_append_i64(StrBuilder *sb, i64 number) {
+    if (number < 0) {
+        j_sb_append_char(sb, '-');
+        // Negating in unsigned arithmetic keeps INT64_MIN representable.
+        j_sb_append_u64(sb, 0 - cast(u64, number));
+    } else {
+        j_sb_append_u64(sb, cast(u64, number));
+    }
+}
+
+void j_sb_format(StrBuilder *sb, const Str format, ...) {
+    va_list args;
+    va_start(args, format);
+    j_maybe(ArenaPtr) mscratch = j_get_scratch();
+    jassert(mscratch.is_present, "Precondition: The scratch space must be initialized before calling this function.\n");
+    Arena *scratch = mscratch.value;
+    j_sb_append(sb, str_format_impl(scratch, format, args));
+    j_release_scratch(scratch);
+    va_end(args);
+}
+
+Str j_sb_build(StrBuilder *sb) {
+    j_sb_reserve(sb, 1);
+    sb->buf[sb->len] = '\0';
+    u32 used = sb->len + 1;
+    // Only a linear arena can take back the tail of an allocation.
+    if (sb->cap > used && sb->arena->flags.allocation_scheme_linear && !sb->arena->flags.use_free_list) {
+        j_free(sb->arena, sb->buf + used, sb->cap - used);
+    }
+    Str out = { .str = sb->buf, .len = sb->len };
+    sb->buf = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+    return out;
+}
+
+// MARK: - Rope Implementation
+
+#define _j_rope_height(rope) ((rope) ? (rope)->height : 0)
+
+/**
+ * @brief Allocates a node followed by extra bytes.
+ */
+static Rope *_j_rope_alloc(Arena *arena, u64 extra) {
+    return _j_alloc_aligned(arena, sizeof(Rope) + extra, _Alignof(Rope));
+}
+
+static const Rope *_j_rope_leaf(Arena *arena, const Str str) {
+    Rope *leaf = _j_rope_alloc(arena, 0);
+    *leaf = (Rope) { .leaf = str, .len = str.len };
+    return leaf;
+}
+
+static const Rope *_j_rope_node(Arena *arena, const Rope *left, const Rope *right) {
+    Rope *node = _j_rope_alloc(arena, 0);
+    u32 height = left->height > right->height ? left->height : right->height;
+    *node = (Rope) { .left = left, .right = right, .len = left->len + right->len, .height = height + 1 };
+    return node;
+}
+
+const Rope *j_rope_from_str(Arena *arena, const Str str) {
+    return str.len == 0 ? NULL : _j_rope_leaf(arena, str);
+}
+
+/**
+ * @brief Joins two non-empty AVL ropes. The taller rope is descended along its inner edge until the heights are
+ * within one, and the path back up is rebalanced with at most one rotation per level.
+ */
+static const Rope *_j_rope_join(Arena *arena, const Rope *a, const Rope *b) {
+    if (a->height == 0 && b->height == 0 && a->len + b->len <= J_ROPE_LEAF_MERGE) {
+        // The merged characters live right after the leaf, in the same allocation.
+        Rope *leaf = _j_rope_alloc(arena, a->len + b->len);
+        char *chars = cast(char *, leaf + 1);
+        memcpy(chars, a->leaf.str, a->leaf.len);
+        memcpy(chars + a->leaf.len, b->leaf.str, b->leaf.len);
+        *leaf = (Rope) { .leaf = { .str = chars, .len = a->leaf.len + b->leaf.len }, .len = a->len + b->len };
+        return leaf;
+    }
+    if (a->height > b->height + 1) {
+        const Rope *r = _j_rope_join(arena, a->right, b);
+        if (r->height <= a->left->height + 1) {
+            return _j_rope_node(arena, a->left, r);
+        }
+        if (_j_rope_height(r->left) <= _j_rope_height(r->right)) {
+            return _j_rope_node(arena, _j_rope_node(arena, a->left, r->left), r->right);
+        }
+        return _j_rope_node(arena, _j_rope_node(arena, a->left, r->left->left),
+                            _j_rope_node(arena, r->left->right, r->right));
+    }
+    if (b->height > a->height + 1) {
+        const Rope *l = _j_rope_join(arena, a, b->left);
+        if (l->height <= b->right->height + 1) {
+            return _j_rope_node(arena, l, b->right);
+        }
+        if (_j_rope_height(l->right) <= _j_rope_height(l->left)) {
+            return _j_rope_node(arena, l->left, _j_rope_node(arena, l->right, b->right));
+        }
+        return _j_rope_node(arena, _j_rope_node(arena, l->left, l->right->left),
+                            _j_rope_node(arena, l->right->right, b->right));
+    }
+    return _j_rope_node(arena, a, b);
+}
+
+const Rope *j_rope_concat(Arena *arena, const Rope *a, const Rope *b) {
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+    return _j_rope_join(arena, a, b);
+}
+
+const Rope *j_rope_slice(Arena *arena, const Rope *rope, u64 begin, u64 end) {
+    jassert(begin <= end && end <= j_rope_len(rope), "Precondition: The slice must lie within the rope\n");
+    if (begin == end) return NULL;
+    if (begin == 0 && end == rope->len) return rope;
+    if (rope->height == 0) {
+        Str str = { .str = rope->leaf.str + begin, .len = cast(u32, end - begin) };
+        return _j_rope_leaf(arena, str);
+    }
+    u64 split = rope->left->len;
+    if (end <= split) return j_rope_slice(arena, rope->left, begin, end);
+    if (begin >= split) return j_rope_slice(arena, rope->right, begin - split, end - split);
+    return _j_rope_join(arena, j_rope_slice(arena, rope->left, begin, split),
+                        j_rope_slice(arena, rope->right, 0, end - split));
+}
+
+char j_rope_at(const Rope *rope, u64 index) {
+    jassert(index < rope->len, "Precondition: The index must be less than the length of the rope\n");
+    while (rope->height > 0) {
+        if (index < rope->left->len) {
+            rope = rope->left;
+        } else {
+            index -= rope->left->len;
+            rope = rope->right;
+        }
+    }
+    return rope->leaf.str[index];
+}
+
+RopeIter j_rope_iter(const Rope *rope) {
+    RopeIter it = { .top = 0 };
+    if (rope != NULL) {
+        it.stack[it.top++] = rope;
+    }
+    return it;
+}
+
+j_maybe(Str) j_rope_next_chunk(RopeIter *it) {
+    if (it->top == 0) return (j_maybe(Str)) { .is_present = false };
+    const Rope *rope = it->stack[--it->top];
+    while (rope->height > 0) {
+        it->stack[it->top++] = rope->right;
+        rope = rope->left;
+    }
+    return (j_maybe(Str)) { .is_present = true, .value = rope->leaf };
+}
+
+void j_sb_append_rope(StrBuilder *sb, const Rope *rope) {
+    jassert(cast(u64, sb->len) + j_rope_len(rope) <= UINT32_MAX, "Precondition: A Str can not be longer than UINT32_MAX\n");
+    j_sb_reserve(sb, cast(u32, j_rope_len(rope)));
+    RopeIter it = j_rope_iter(rope);
+    j_maybe(Str) chunk;
+    while ((chunk = j_rope_next_chunk(&it)).is_present) {
+        memcpy(sb->buf + sb->len, chunk.value.str, chunk.value.len);
+        sb->len += chunk.value.len;
+    }
+}
+
+Str j_rope_flatten(Arena *arena, const Rope *rope) {
+    StrBuilder sb = j_sb_make(arena, cast(u32, j_rope_len(rope)) + 1);
+    j_sb_append_rope(&sb, rope);
+    return j_sb_build(&sb);
+}
+
+#undef _j_rope_height
+
 #endif
 
 #undef _j_rb_is_left_sibling
@@ -0,0 +1,100 @@
+//
+// Round trips numbers through the {i32}, {i64} and {f64} printers and back through j_ss_parse_i64 and
+// j_ss_parse_f64, and checks that every value comes back bit for bit.
+//
+#define JLIB_IMPL
+
+#include <dirent.h>
+#include <float.h>
+#include <math.h>
+#include "../jlib.h"
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+
+static u64 next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void check_i64(Arena *arena, i64 value) {
+    const Str printed = str_format(arena, "{i64}", value);
+    j_maybe(i64) parsed = j_ss_parse_i64((SubStr) { .str = printed });
+    if (!parsed.is_present || parsed.value != value) {
+        printf("i64 round trip failed for %lld, printed %.*s\n", cast(long long, value), printed.len, printed.str);
+        exit(1);
+    }
+}
+
+static void check_i32(Arena *arena, i32 value) {
+    const Str printed = str_format(arena, "{i32}", value);
+    j_maybe(i64) parsed = j_ss_parse_i64((SubStr) { .str = printed });
+    if (!parsed.is_present || parsed.value != value) {
+        printf("i32 round trip failed for %d, printed %.*s\n", value, printed.len, printed.str);
+        exit(1);
+    }
+}
+
+static void check_f64(Arena *arena, f64 value) {
+    const Str printed = str_format(arena, "{f64}", value);
+    j_maybe(f64) parsed = j_ss_parse_f64((SubStr) { .str = printed });
+    u64 expected_bits, parsed_bits;
+    memcpy(&expected_bits, &value, sizeof(value));
+    memcpy(&parsed_bits, &parsed.value, sizeof(parsed.value));
+    if (!parsed.is_present || parsed_bits != expected_bits) {
+        printf("f64 round trip failed for %a, printed %.*s\n", value, printed.len, printed.str);
+        exit(1);
+    }
+}
+
+int main(void) {
+    Arena program_memory = j_make_arena(J_MB(64), false);
+    program_memory.flags.allocation_scheme_linear = 1;
+    j_init_scratch(&program_memory, 2, J_MB(4));
+    init_printers(&program_memory);
+    Arena arena = j_make_scratch(&program_memory, J_MB(32));
+
+    const i64 integers[] = { 0, 1, -1, 9, 10, -10, 99, 100, INT32_MIN, INT32_MAX, cast(i64, INT32_MAX) + 1,
+                             999999999999999999ll, 1000000000000000000ll, -1000000000000000000ll,
+                             INT64_MAX, INT64_MAX - 1, INT64_MIN, INT64_MIN + 1 };
+    for (u32 i = 0; i < sizeof(integers) / sizeof(integers[0]); ++i) {
+        check_i64(&arena, integers[i]);
+    }
+    check_i32(&arena, INT32_MIN);
+    check_i32(&arena, INT32_MAX);
+    check_i32(&arena, 0);
+    check_i32(&arena, -7);
+    for (u32 i = 0; i < 100000; ++i) {
+        u64 bits = next_random();
+        check_i64(&arena, cast(i64, bits >> (bits & 63)));
+        check_i64(&arena, cast(i64, bits));
+        check_i32(&arena, cast(i32, bits));
+        j_reset_arena(&arena);
+    }
+
+    const f64 doubles[] = { 0.0, -0.0, 1.0, -1.0, 0.1, 0.5, 1.0 / 3.0, 100.0, 1e23, 8.98846567431158e307,
+                            9007199254740992.0, 9007199254740993.0, 4503599627370497.5, 123456789012345678.0,
+                            DBL_MAX, -DBL_MAX, DBL_MIN, -DBL_MIN, DBL_EPSILON, 1.0 + DBL_EPSILON,
+                            DBL_TRUE_MIN, -DBL_TRUE_MIN, 2 * DBL_TRUE_MIN, DBL_MIN - DBL_TRUE_MIN,
+                            nextafter(DBL_MIN, 0.0), nextafter(DBL_MAX, 0.0), nextafter(1.0, 2.0), nextafter(1.0, 0.0) };
+    for (u32 i = 0; i < sizeof(doubles) / sizeof(doubles[0]); ++i) {
+        check_f64(&arena, doubles[i]);
+    }
+    for (u32 i = 0; i < 100000; ++i) {
+        // Random bit patterns cover every exponent, the ones with a zero exponent are subnormals.
+        u64 bits = next_random();
+        f64 value;
+        memcpy(&value, &bits, sizeof(value));
+        if (isfinite(value)) {
+            check_f64(&arena, value);
+        }
+        bits &= 0x800FFFFFFFFFFFFFull;
+        memcpy(&value, &bits, sizeof(value));
+        check_f64(&arena, value);
+        j_reset_arena(&arena);
+    }
+
+    printf("number parsing round trips passed\n");
+    return 0;
+}